@@ -1,12 +1,23 @@
 #version 330 core
 in vec2 texCoords;
+#ifdef TEXTURE_ARRAY
+flat in float layer;
+#endif
 
 out vec4 fragColor;
 
+#ifdef TEXTURE_ARRAY
+uniform sampler2DArray texture1;
+#else
 uniform sampler2D texture1;
+#endif
 
 void main() {
+#ifdef TEXTURE_ARRAY
+	vec4 texColor = texture(texture1, vec3(texCoords, layer));
+#else
 	vec4 texColor = texture(texture1, texCoords);
+#endif
 
 	if (texColor.a < 0.1) {
 		// ensures the fragment will not be further processed and thus not end up into the color buffer
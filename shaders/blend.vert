@@ -1,14 +1,20 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoords;
+#ifdef TEXTURE_ARRAY
+// the layer of the texture array each instance shows, after the matrices of transform.glsl
+layout (location = 10) in float instanceLayer;
+flat out float layer;
+#endif
 
 out vec2 texCoords;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "include/transform.glsl"
 
 void main() {
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
+	gl_Position = clipPosition(aPos);
 	texCoords = aTexCoords;
+#ifdef TEXTURE_ARRAY
+	layer = instanceLayer;
+#endif
 }
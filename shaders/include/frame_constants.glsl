@@ -0,0 +1,7 @@
+// shared by all programs and filled once per frame
+layout (std140) uniform FrameConstants {
+	mat4 view;
+	mat4 projection;
+	vec4 cameraPosition;
+	float time;
+};
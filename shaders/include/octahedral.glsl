@@ -0,0 +1,9 @@
+// Unit vectors stored as two components, see ATTRIBUTE_OCTAHEDRAL in vertex_format.h.
+// The square [-1, 1]^2 is folded back onto the octahedron |x| + |y| + |z| = 1, normalizing gives the vector again.
+vec3 decodeOctahedral(vec2 encoded) {
+	vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	if (n.z < 0.0) {
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return normalize(n);
+}
@@ -0,0 +1,32 @@
+// The transformation every vertex shader does, included by all of them
+#include "frame_constants.glsl"
+
+#ifdef INSTANCED
+// one matrix pair per instance, read from the instance buffer (see glVertexAttribDivisor in main.cpp)
+layout (location = 3) in mat4 instanceModel;
+layout (location = 7) in mat3 instanceNormalMatrix;
+#define MODEL instanceModel
+#define NORMAL_MATRIX instanceNormalMatrix
+#else
+uniform mat4 model;
+// inverse transpose of the model matrix, computed on the CPU once per object instead of once per vertex
+uniform mat3 normalMatrix;
+#define MODEL model
+#define NORMAL_MATRIX normalMatrix
+#endif
+
+// transform a vertex position from the model's local space to world space
+vec4 worldPosition(vec3 position) {
+	return MODEL * vec4(position, 1.0);
+}
+
+// transform a vertex position from the model's local space to clip space
+vec4 clipPosition(vec3 position) {
+	// read the multiplication from right to left
+	return projection * view * MODEL * vec4(position, 1.0);
+}
+
+// transform a normal to world space, this also works with non-uniform scaling
+vec3 worldNormal(vec3 direction) {
+	return NORMAL_MATRIX * direction;
+}
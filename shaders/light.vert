@@ -2,11 +2,8 @@
 
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "include/transform.glsl"
 	
 void main() {
-	// read the multiplication from right to left
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
+	gl_Position = clipPosition(aPos);
 }
\ No newline at end of file
@@ -14,13 +14,23 @@ uniform vec3 lightColor;
 
 uniform vec3 lightPosition;
 
-uniform vec3 cameraPosition;
+#include "include/frame_constants.glsl"
+
+// The lighting constants are compile time defines, so every variant has them folded into its code
+#ifndef AMBIENT_STRENGTH
+#define AMBIENT_STRENGTH 0.2
+#endif
+#ifndef SPECULAR_STRENGTH
+#define SPECULAR_STRENGTH 0.5
+#endif
+#ifndef SHININESS
+#define SHININESS 32.0
+#endif
 
 void main() {
     // We do lighting currently in world space but is more common to do it in view space as you get the view/camera position for free. It is always (0, 0, 0) in view space.
     // ambient lighting
-    float ambientStrength = 0.2;
-    vec3 ambient = ambientStrength * lightColor;
+    vec3 ambient = AMBIENT_STRENGTH * lightColor;
 
     // diffuse lighting (normalize vectors so the calculation gets easier)
     vec3 norm = normalize(normal);
@@ -29,12 +39,10 @@ void main() {
     vec3 diffuse = max(dot(norm, lightDirection), 0.0) * lightColor;
 
     // specular lighting
-    float specularStrength = 0.5;
-    int shininess = 32;
-    vec3 viewDirection = normalize(cameraPosition - fragPosition);
+    vec3 viewDirection = normalize(cameraPosition.xyz - fragPosition);
     vec3 reflectDirection = reflect(-lightDirection, norm);
-    float spec = pow(max(dot(viewDirection, reflectDirection), 0.0), shininess);
-    vec3 specular = specularStrength * spec * lightColor;
+    float spec = pow(max(dot(viewDirection, reflectDirection), 0.0), SHININESS);
+    vec3 specular = SPECULAR_STRENGTH * spec * lightColor;
 
     // create phong lighting
     vec3 lighting = (ambient + diffuse + specular) * objectColor;
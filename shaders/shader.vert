@@ -2,23 +2,30 @@
 
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoord;
+#ifdef OCTAHEDRAL_NORMALS
+// the normals are stored as two components (ATTRIBUTE_OCTAHEDRAL)
+#include "include/octahedral.glsl"
+layout (location = 2) in vec2 aNormal;
+#else
 layout (location = 2) in vec3 aNormal;
+#endif
 
 out vec2 texCoord;
 out vec3 normal;
 out vec3 fragPosition;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "include/transform.glsl"
 	
 void main() {
-	// read the multiplication from right to left
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
+	gl_Position = clipPosition(aPos);
 	texCoord = aTexCoord;
 	// we need the world fragment position and the normal for diffuse light calculation
 	// multiply the normal vector with a normal matrix so world space is also applied to the normal vector and non-uniform scaling works
-	// NOTE: Inversing matrices is a costly operation for shaders, so wherever possible try to avoid doing inverse operations since they have to be done on each vertex of your scene. For learning purposes this is fine, but for an efficient application you'll likely want to calculate the normal matrix on the CPU and send it to the shaders via a uniform before drawing (just like the model matrix).
-	normal = mat3(transpose(inverse(model))) * aNormal;
-	fragPosition = vec3(model * vec4(aPos, 1.0));
+	// NOTE: Inversing matrices is a costly operation for shaders, so the normal matrix is calculated on the CPU (see TransformBatch) and sent to the shader together with the model matrix.
+#ifdef OCTAHEDRAL_NORMALS
+	normal = worldNormal(decodeOctahedral(aNormal));
+#else
+	normal = worldNormal(aNormal);
+#endif
+	fragPosition = vec3(worldPosition(aPos));
 }
\ No newline at end of file
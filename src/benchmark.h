@@ -0,0 +1,283 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#include "gpu_timer.h"
+#include "glad_instrument.h"
+
+using namespace std;
+
+// Counters the render loop fills in while building a frame
+struct FrameCounters {
+	unsigned int drawCalls = 0;
+	// Objects drawn, with instancing one draw call draws many of them
+	unsigned int instances = 0;
+	unsigned int stateChanges = 0;
+	// 1 if the CPU had to wait for the GPU to release a range of the frame uniform buffer
+	unsigned int uniformStalls = 0;
+	// Filled from the instrumented glad dispatch when it is installed
+	unsigned int glCalls = 0;
+	unsigned int redundantBinds = 0;
+	unsigned int redundantUniforms = 0;
+	double driverTime = 0.0;
+};
+
+// Drives the render loop with a fixed simulated clock so every run renders exactly the same frames.
+// The first warmupFrames frames are rendered but not recorded (shader compilation, driver caches...),
+// after that the CPU time, GPU time and counters of every frame are collected and written into a JSON report.
+// The GPU time of a frame comes from two timestamp queries kept in a ring like the GpuTimer's, they are read back
+// FRAME_LATENCY frames later and a frame whose result is not available by then is dropped instead of waited for.
+class Benchmark {
+public:
+	Benchmark(unsigned int warmupFrames, unsigned int measuredFrames, double timeStep = 1.0 / 60.0)
+		: warmupFrames(warmupFrames), measuredFrames(measuredFrames), timeStep(timeStep) {
+	}
+
+	static const unsigned int FRAME_LATENCY = GpuTimer::FRAME_LATENCY;
+
+	// Delete the queries, call this while the context is still current
+	void destroy() {
+		if (!queries.empty()) {
+			glDeleteQueries((GLsizei)queries.size(), queries.data());
+		}
+		queries.clear();
+		slots.clear();
+	}
+
+	// The simulated time of the current frame in seconds, use this instead of the wall clock for animations
+	double time() const {
+		return frame * timeStep;
+	}
+
+	bool done() const {
+		return frame >= warmupFrames + measuredFrames;
+	}
+
+	bool measuring() const {
+		return frame >= warmupFrames;
+	}
+
+	void beginFrame() {
+		cpuStart = chrono::steady_clock::now();
+
+		if (measuring()) {
+			if (queries.empty()) {
+				queries.resize(FRAME_LATENCY * 2);
+				glGenQueries((GLsizei)queries.size(), queries.data());
+				slots.assign(FRAME_LATENCY, NO_FRAME);
+			}
+			slot = (slot + 1) % FRAME_LATENCY;
+			// The slot was last used FRAME_LATENCY frames ago, by now its result should be there
+			resolve(slot, false);
+			slots[slot] = cpuTimes.size();
+			gpuTimes.push_back(0.0);
+			glQueryCounter(queries[slot * 2], GL_TIMESTAMP);
+		}
+	}
+
+	void endFrame(const FrameCounters& counters) {
+		if (measuring()) {
+			glQueryCounter(queries[slot * 2 + 1], GL_TIMESTAMP);
+			cpuTimes.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - cpuStart).count());
+			frameCounters.push_back(counters);
+
+			// Sum up the calls of every GL entry point to report the average per frame
+			if (gladInstrumentInstalled()) {
+				glEntryCalls.resize(gladInstrumentEntryCount(), 0.0);
+				glEntrySeconds.resize(gladInstrumentEntryCount(), 0.0);
+				for (unsigned int i = 0; i < gladInstrumentEntryCount(); i++) {
+					glEntryCalls[i] += gladInstrumentEntry(i)->frameCalls;
+					glEntrySeconds[i] += gladInstrumentEntry(i)->frameSeconds;
+				}
+			}
+		}
+		frame++;
+	}
+
+	// Pass the GPU timer to also report the time of every render pass it recorded
+	bool writeReport(const char* path, const GpuTimer* gpuTimer = NULL) {
+		// Collect the GPU times still in flight, this waits for the last frames to finish
+		for (unsigned int i = 0; i < slots.size(); i++) {
+			resolve(i, true);
+		}
+		gpuResolved.resize(gpuTimes.size(), false);
+		vector<double> resolvedGpuTimes;
+		for (size_t i = 0; i < gpuTimes.size(); i++) {
+			if (gpuResolved[i]) {
+				resolvedGpuTimes.push_back(gpuTimes[i]);
+			}
+		}
+
+		ofstream file(path);
+		if (!file) {
+			cout << "ERROR::BENCHMARK::REPORT_NOT_WRITABLE " << path << endl;
+			return false;
+		}
+
+		file << "{\n";
+		file << "\t\"renderer\": \"" << escape((const char*)glGetString(GL_RENDERER)) << "\",\n";
+		file << "\t\"warmupFrames\": " << warmupFrames << ",\n";
+		file << "\t\"measuredFrames\": " << cpuTimes.size() << ",\n";
+		file << "\t\"timeStep\": " << timeStep << ",\n";
+		writeSummary(file, "\t", "cpuTimeMs", cpuTimes);
+		file << ",\n";
+		writeSummary(file, "\t", "gpuTimeMs", resolvedGpuTimes);
+		file << ",\n";
+		file << "\t\"gpuTimeDroppedFrames\": " << gpuTimes.size() - resolvedGpuTimes.size() << ",\n";
+		if (gpuTimer != NULL) {
+			file << "\t\"gpuPassTimeMs\": {\n";
+			for (unsigned int pass = 0; pass < gpuTimer->passNames.size(); pass++) {
+				writeSummary(file, "\t\t", gpuTimer->passNames[pass], gpuTimer->passSamples(pass));
+				file << (pass + 1 < gpuTimer->passNames.size() ? ",\n" : "\n");
+			}
+			file << "\t},\n";
+			file << "\t\"gpuDroppedFrames\": " << gpuTimer->droppedFrames() << ",\n";
+		}
+		FrameCounters last = frameCounters.empty() ? FrameCounters() : frameCounters.back();
+		file << "\t\"drawCalls\": " << last.drawCalls << ",\n";
+		file << "\t\"instances\": " << last.instances << ",\n";
+		file << "\t\"stateChanges\": " << last.stateChanges << ",\n";
+		// if this isn't 0 the ring of the frame uniform buffer is too short for the frames the driver queues
+		unsigned int uniformStalls = 0;
+		for (const FrameCounters& counters : frameCounters) {
+			uniformStalls += counters.uniformStalls;
+		}
+		file << "\t\"uniformBufferStalls\": " << uniformStalls << ",\n";
+		if (!glEntryCalls.empty()) {
+			vector<double> driverTimes;
+			for (const FrameCounters& counters : frameCounters) {
+				driverTimes.push_back(counters.driverTime * 1000.0);
+			}
+			writeSummary(file, "\t", "driverTimeMs", driverTimes);
+			file << ",\n";
+			file << "\t\"glCallsPerFrame\": {\n";
+			bool first = true;
+			for (unsigned int i = 0; i < glEntryCalls.size(); i++) {
+				if (glEntryCalls[i] == 0.0) {
+					continue;
+				}
+				file << (first ? "" : ",\n") << "\t\t\"" << gladInstrumentEntry(i)->name << "\": { "
+					<< "\"calls\": " << glEntryCalls[i] / frameCounters.size()
+					<< ", \"driverTimeMs\": " << glEntrySeconds[i] * 1000.0 / frameCounters.size() << " }";
+				first = false;
+			}
+			file << "\n\t},\n";
+		}
+		file << "\t\"frames\": [\n";
+		for (size_t i = 0; i < cpuTimes.size(); i++) {
+			const FrameCounters& counters = frameCounters[i];
+			file << "\t\t{ \"cpuTimeMs\": " << cpuTimes[i] << ", \"gpuTimeMs\": ";
+			// null if the result of the frame was dropped
+			if (gpuResolved[i]) {
+				file << gpuTimes[i];
+			} else {
+				file << "null";
+			}
+			file << ", \"drawCalls\": " << counters.drawCalls
+				<< ", \"stateChanges\": " << counters.stateChanges;
+			if (!glEntryCalls.empty()) {
+				file << ", \"glCalls\": " << counters.glCalls
+					<< ", \"redundantBinds\": " << counters.redundantBinds
+					<< ", \"redundantUniforms\": " << counters.redundantUniforms
+					<< ", \"driverTimeMs\": " << counters.driverTime * 1000.0;
+			}
+			file << " }" << (i + 1 < cpuTimes.size() ? "," : "") << "\n";
+		}
+		file << "\t]\n";
+		file << "}\n";
+
+		cout << "Benchmark report written to " << path << endl;
+		return true;
+	}
+
+private:
+	unsigned int warmupFrames;
+	unsigned int measuredFrames;
+	double timeStep;
+	unsigned int frame = 0;
+
+	chrono::steady_clock::time_point cpuStart;
+	// A start and an end timestamp per slot, and the measured frame each slot holds
+	static const size_t NO_FRAME = (size_t)-1;
+	vector<unsigned int> queries;
+	vector<size_t> slots;
+	unsigned int slot = 0;
+	vector<double> gpuTimes;
+	vector<bool> gpuResolved;
+	vector<double> cpuTimes;
+	vector<FrameCounters> frameCounters;
+	vector<double> glEntryCalls;
+	vector<double> glEntrySeconds;
+
+	void resolve(unsigned int frameSlot, bool wait) {
+		size_t measured = slots[frameSlot];
+		if (measured == NO_FRAME) {
+			return;
+		}
+		slots[frameSlot] = NO_FRAME;
+		gpuResolved.resize(gpuTimes.size(), false);
+		if (!wait) {
+			// The end timestamp is written last, once it is available the start is too
+			GLint available = 0;
+			glGetQueryObjectiv(queries[frameSlot * 2 + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) {
+				return;
+			}
+		}
+		GLuint64 start = 0, end = 0;
+		glGetQueryObjectui64v(queries[frameSlot * 2], GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(queries[frameSlot * 2 + 1], GL_QUERY_RESULT, &end);
+		gpuTimes[measured] = (end - start) / 1000000.0;
+		gpuResolved[measured] = true;
+	}
+
+	// The renderer string comes from the driver, quotes and backslashes would break the JSON
+	static string escape(const char* text) {
+		string escaped;
+		for (const char* c = text != NULL ? text : ""; *c != '\0'; c++) {
+			if (*c == '"' || *c == '\\') {
+				escaped += '\\';
+			}
+			if ((unsigned char)*c >= 0x20) {
+				escaped += *c;
+			}
+		}
+		return escaped;
+	}
+
+	// Nearest-rank percentile of already sorted values
+	static double percentile(const vector<double>& sorted, double p) {
+		if (sorted.empty()) {
+			return 0.0;
+		}
+		size_t rank = (size_t)(p / 100.0 * sorted.size() + 0.5);
+		rank = min(max(rank, (size_t)1), sorted.size());
+		return sorted[rank - 1];
+	}
+
+	static void writeSummary(ofstream& file, const char* indent, const char* name, vector<double> values) {
+		sort(values.begin(), values.end());
+		double sum = 0.0;
+		for (double value : values) {
+			sum += value;
+		}
+		file << indent << "\"" << name << "\": { "
+			<< "\"mean\": " << (values.empty() ? 0.0 : sum / values.size())
+			<< ", \"min\": " << (values.empty() ? 0.0 : values.front())
+			<< ", \"max\": " << (values.empty() ? 0.0 : values.back())
+			<< ", \"p50\": " << percentile(values, 50.0)
+			<< ", \"p95\": " << percentile(values, 95.0)
+			<< ", \"p99\": " << percentile(values, 99.0)
+			<< " }";
+	}
+};
+
+#endif
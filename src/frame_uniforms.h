@@ -0,0 +1,109 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+// Per frame constants shared by all shader programs, the layout has to match the std140 uniform block
+//
+//	layout (std140) uniform FrameConstants {
+//		mat4 view;
+//		mat4 projection;
+//		vec4 cameraPosition;
+//		float time;
+//	};
+struct FrameConstants {
+	glm::mat4 view;
+	glm::mat4 projection;
+	// std140 rounds a vec3 up to 16 bytes anyway, so we use a vec4 (w is unused)
+	glm::vec4 cameraPosition;
+	float time;
+	float padding[3];
+};
+static_assert(sizeof(FrameConstants) == 160, "FrameConstants does not match the std140 layout");
+
+// Uploads the FrameConstants once per frame into a uniform buffer all programs read from.
+// The buffer holds FRAMES_IN_FLIGHT copies, each frame writes the next one while the GPU may still read the
+// previous ones. A fence per copy tells us when the GPU is done with it, so we can map the range unsynchronized
+// and the driver never has to wait for the GPU before handing us the memory.
+class FrameUniformBuffer {
+public:
+	static const unsigned int BINDING = 0;
+	static const unsigned int FRAMES_IN_FLIGHT = 3;
+
+	unsigned int id = 0;
+
+	void create() {
+		// Every range we bind has to start at a multiple of the offset alignment
+		GLint alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		stride = ((sizeof(FrameConstants) + alignment - 1) / alignment) * alignment;
+
+		glGenBuffers(1, &id);
+		glBindBuffer(GL_UNIFORM_BUFFER, id);
+		glBufferData(GL_UNIFORM_BUFFER, stride * FRAMES_IN_FLIGHT, NULL, GL_STREAM_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	void destroy() {
+		for (unsigned int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+			if (fences[i] != NULL) {
+				glDeleteSync(fences[i]);
+				fences[i] = NULL;
+			}
+		}
+		glDeleteBuffers(1, &id);
+		id = 0;
+	}
+
+	// Writes the constants into the next range of the ring and binds it to BINDING
+	void update(const FrameConstants& constants) {
+		slot = (slot + 1) % FRAMES_IN_FLIGHT;
+
+		// The GPU should be done with this range since it was used FRAMES_IN_FLIGHT frames ago
+		if (fences[slot] != NULL) {
+			if (glClientWaitSync(fences[slot], 0, 0) == GL_TIMEOUT_EXPIRED) {
+				stalls++;
+				glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+			}
+			glDeleteSync(fences[slot]);
+			fences[slot] = NULL;
+		}
+
+		glBindBuffer(GL_UNIFORM_BUFFER, id);
+		void* memory = glMapBufferRange(GL_UNIFORM_BUFFER, slot * stride, sizeof(FrameConstants),
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		if (memory != NULL) {
+			memcpy(memory, &constants, sizeof(FrameConstants));
+			glUnmapBuffer(GL_UNIFORM_BUFFER);
+		} else {
+			cout << "ERROR::FRAME_UNIFORMS::MAP_FAILED" << endl;
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+		glBindBufferRange(GL_UNIFORM_BUFFER, BINDING, id, slot * stride, sizeof(FrameConstants));
+	}
+
+	// Call after the last draw call of the frame which reads the constants
+	void endFrame() {
+		fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	// Frames where the CPU had to wait for the GPU to release a range
+	unsigned int stallCount() const {
+		return stalls;
+	}
+
+private:
+	GLsync fences[FRAMES_IN_FLIGHT] = {};
+	unsigned int stride = 0;
+	unsigned int slot = 0;
+	unsigned int stalls = 0;
+};
+
+#endif
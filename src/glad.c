@@ -7,16 +7,19 @@
     APIs: gl=3.3
     Profile: compatibility
     Extensions:
-        
+        ARB_get_program_binary
+        ARB_texture_compression_bptc
+        EXT_texture_compression_s3tc
+        KHR_parallel_shader_compile
     Loader: True
     Local files: False
     Omit khrplatform: False
     Reproducible: False
 
     Commandline:
-        --profile="compatibility" --api="gl=3.3" --generator="c" --spec="gl" --extensions=""
+        --profile="compatibility" --api="gl=3.3" --generator="c" --spec="gl" --extensions="ARB_get_program_binary,ARB_texture_compression_bptc,EXT_texture_compression_s3tc,KHR_parallel_shader_compile"
     Online:
-        https://glad.dav1d.de/#profile=compatibility&language=c&specification=gl&loader=on&api=gl%3D3.3
+        https://glad.dav1d.de/#profile=compatibility&language=c&specification=gl&loader=on&api=gl%3D3.3&extensions=ARB_get_program_binary&extensions=ARB_texture_compression_bptc&extensions=EXT_texture_compression_s3tc&extensions=KHR_parallel_shader_compile
 */
 
 #include <stdio.h>
@@ -267,6 +270,10 @@ int GLAD_GL_VERSION_3_0 = 0;
 int GLAD_GL_VERSION_3_1 = 0;
 int GLAD_GL_VERSION_3_2 = 0;
 int GLAD_GL_VERSION_3_3 = 0;
+int GLAD_GL_ARB_get_program_binary = 0;
+int GLAD_GL_KHR_parallel_shader_compile = 0;
+int GLAD_GL_EXT_texture_compression_s3tc = 0;
+int GLAD_GL_ARB_texture_compression_bptc = 0;
 PFNGLACCUMPROC glad_glAccum = NULL;
 PFNGLACTIVETEXTUREPROC glad_glActiveTexture = NULL;
 PFNGLALPHAFUNCPROC glad_glAlphaFunc = NULL;
@@ -991,6 +998,10 @@ PFNGLWINDOWPOS3IPROC glad_glWindowPos3i = NULL;
 PFNGLWINDOWPOS3IVPROC glad_glWindowPos3iv = NULL;
 PFNGLWINDOWPOS3SPROC glad_glWindowPos3s = NULL;
 PFNGLWINDOWPOS3SVPROC glad_glWindowPos3sv = NULL;
+PFNGLGETPROGRAMBINARYPROC glad_glGetProgramBinary = NULL;
+PFNGLPROGRAMBINARYPROC glad_glProgramBinary = NULL;
+PFNGLPROGRAMPARAMETERIPROC glad_glProgramParameteri = NULL;
+PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glad_glMaxShaderCompilerThreadsKHR = NULL;
 static void load_GL_VERSION_1_0(GLADloadproc load) {
 	if(!GLAD_GL_VERSION_1_0) return;
 	glad_glCullFace = (PFNGLCULLFACEPROC)load("glCullFace");
@@ -1754,9 +1765,23 @@ static void load_GL_VERSION_3_3(GLADloadproc load) {
 	glad_glSecondaryColorP3ui = (PFNGLSECONDARYCOLORP3UIPROC)load("glSecondaryColorP3ui");
 	glad_glSecondaryColorP3uiv = (PFNGLSECONDARYCOLORP3UIVPROC)load("glSecondaryColorP3uiv");
 }
+static void load_GL_ARB_get_program_binary(GLADloadproc load) {
+	if(!GLAD_GL_ARB_get_program_binary) return;
+	glad_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+	glad_glProgramBinary = (PFNGLPROGRAMBINARYPROC)load("glProgramBinary");
+	glad_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+}
+static void load_GL_KHR_parallel_shader_compile(GLADloadproc load) {
+	if(!GLAD_GL_KHR_parallel_shader_compile) return;
+	glad_glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsKHR");
+}
 static int find_extensionsGL(void) {
 	if (!get_exts()) return 0;
 	(void)&has_ext;
+	GLAD_GL_ARB_get_program_binary = has_ext("GL_ARB_get_program_binary");
+	GLAD_GL_KHR_parallel_shader_compile = has_ext("GL_KHR_parallel_shader_compile");
+	GLAD_GL_EXT_texture_compression_s3tc = has_ext("GL_EXT_texture_compression_s3tc");
+	GLAD_GL_ARB_texture_compression_bptc = has_ext("GL_ARB_texture_compression_bptc");
 	free_exts();
 	return 1;
 }
@@ -1835,6 +1860,451 @@ int gladLoadGLLoader(GLADloadproc load) {
 	load_GL_VERSION_3_3(load);
 
 	if (!find_extensionsGL()) return 0;
+	load_GL_ARB_get_program_binary(load);
+	load_GL_KHR_parallel_shader_compile(load);
 	return GLVersion.major != 0 || GLVersion.minor != 0;
 }
 
+
+
+/*
+    Instrumented dispatch (see glad_instrument.h)
+
+    Every wrapper forwards to the original driver entry point, counts the call and measures
+    the time spent inside the driver. The bind and uniform wrappers additionally keep a shadow
+    copy of the state they change to detect calls which would not change anything.
+*/
+
+#include "glad_instrument.h"
+
+#if defined(_WIN32) || defined(__CYGWIN__)
+static double glad_instrument_now(void) {
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if(frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+}
+#else
+#include <time.h>
+static double glad_instrument_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+#endif
+
+#define GLAD_INSTRUMENTED_FUNCTIONS(X) \
+    X(ActiveTexture) X(BindBuffer) X(BindBufferRange) X(BindFramebuffer) X(BindTexture) X(BindVertexArray) \
+    X(BlendFunc) X(BufferData) X(BufferSubData) X(Clear) X(ClearColor) X(ClientWaitSync) \
+    X(CompressedTexImage2D) X(CompressedTexImage3D) X(CompressedTexSubImage2D) X(CompressedTexSubImage3D) \
+    X(DeleteBuffers) X(DeleteProgram) X(DeleteTextures) X(DeleteVertexArrays) X(Disable) \
+    X(DrawArrays) X(DrawArraysInstanced) X(DrawElements) X(DrawElementsInstanced) \
+    X(Enable) X(EnableVertexAttribArray) X(FenceSync) X(Finish) X(Flush) X(GenerateMipmap) \
+    X(GetQueryObjectiv) X(GetQueryObjectui64v) X(GetUniformLocation) X(LinkProgram) \
+    X(MapBufferRange) X(PixelStorei) X(PolygonMode) X(ProgramBinary) X(QueryCounter) \
+    X(TexImage2D) X(TexImage3D) X(TexParameteri) X(TexSubImage2D) X(TexSubImage3D) \
+    X(Uniform1f) X(Uniform1i) X(Uniform3f) X(Uniform3fv) X(UniformMatrix3fv) X(UniformMatrix4fv) \
+    X(UnmapBuffer) X(UseProgram) X(VertexAttribPointer) X(Viewport)
+
+enum {
+#define GLAD_STAT_ENUM(name) GLAD_STAT_##name,
+    GLAD_INSTRUMENTED_FUNCTIONS(GLAD_STAT_ENUM)
+#undef GLAD_STAT_ENUM
+    GLAD_STAT_COUNT
+};
+
+static GLADcallStats glad_call_stats[GLAD_STAT_COUNT] = {
+#define GLAD_STAT_NAME(name) { "gl" #name, 0, 0.0, 0, 0.0 },
+    GLAD_INSTRUMENTED_FUNCTIONS(GLAD_STAT_NAME)
+#undef GLAD_STAT_NAME
+};
+
+static unsigned int glad_frame_calls[GLAD_STAT_COUNT];
+static double glad_frame_seconds[GLAD_STAT_COUNT];
+static GLADframeStats glad_current_frame;
+static GLADframeStats glad_last_frame;
+static int glad_instrument_installed = 0;
+
+static void glad_instrument_record(int stat, double start) {
+    double seconds = glad_instrument_now() - start;
+    glad_frame_calls[stat]++;
+    glad_frame_seconds[stat] += seconds;
+    glad_current_frame.calls++;
+    glad_current_frame.driverSeconds += seconds;
+}
+
+/* Generic wrappers which only count and time */
+#define GLAD_WRAP_VOID(type, name, params, args) \
+    static type glad_orig_gl##name; \
+    static void APIENTRY glad_instrumented_gl##name params { \
+        double start = glad_instrument_now(); \
+        glad_orig_gl##name args; \
+        glad_instrument_record(GLAD_STAT_##name, start); \
+    }
+
+#define GLAD_WRAP_RETURN(type, result, name, params, args) \
+    static type glad_orig_gl##name; \
+    static result APIENTRY glad_instrumented_gl##name params { \
+        double start = glad_instrument_now(); \
+        result value = glad_orig_gl##name args; \
+        glad_instrument_record(GLAD_STAT_##name, start); \
+        return value; \
+    }
+
+GLAD_WRAP_VOID(PFNGLBINDBUFFERRANGEPROC, BindBufferRange, (GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size), (target, index, buffer, offset, size))
+GLAD_WRAP_VOID(PFNGLBINDFRAMEBUFFERPROC, BindFramebuffer, (GLenum target, GLuint framebuffer), (target, framebuffer))
+GLAD_WRAP_VOID(PFNGLBLENDFUNCPROC, BlendFunc, (GLenum sfactor, GLenum dfactor), (sfactor, dfactor))
+GLAD_WRAP_VOID(PFNGLBUFFERDATAPROC, BufferData, (GLenum target, GLsizeiptr size, const void* data, GLenum usage), (target, size, data, usage))
+GLAD_WRAP_VOID(PFNGLBUFFERSUBDATAPROC, BufferSubData, (GLenum target, GLintptr offset, GLsizeiptr size, const void* data), (target, offset, size, data))
+GLAD_WRAP_VOID(PFNGLCLEARPROC, Clear, (GLbitfield mask), (mask))
+GLAD_WRAP_VOID(PFNGLCLEARCOLORPROC, ClearColor, (GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha), (red, green, blue, alpha))
+GLAD_WRAP_RETURN(PFNGLCLIENTWAITSYNCPROC, GLenum, ClientWaitSync, (GLsync sync, GLbitfield flags, GLuint64 timeout), (sync, flags, timeout))
+GLAD_WRAP_VOID(PFNGLCOMPRESSEDTEXIMAGE2DPROC, CompressedTexImage2D, (GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const void* data), (target, level, internalformat, width, height, border, imageSize, data))
+GLAD_WRAP_VOID(PFNGLCOMPRESSEDTEXIMAGE3DPROC, CompressedTexImage3D, (GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLsizei imageSize, const void* data), (target, level, internalformat, width, height, depth, border, imageSize, data))
+GLAD_WRAP_VOID(PFNGLCOMPRESSEDTEXSUBIMAGE2DPROC, CompressedTexSubImage2D, (GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, const void* data), (target, level, xoffset, yoffset, width, height, format, imageSize, data))
+GLAD_WRAP_VOID(PFNGLCOMPRESSEDTEXSUBIMAGE3DPROC, CompressedTexSubImage3D, (GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLsizei imageSize, const void* data), (target, level, xoffset, yoffset, zoffset, width, height, depth, format, imageSize, data))
+GLAD_WRAP_VOID(PFNGLDISABLEPROC, Disable, (GLenum cap), (cap))
+GLAD_WRAP_VOID(PFNGLDRAWARRAYSPROC, DrawArrays, (GLenum mode, GLint first, GLsizei count), (mode, first, count))
+GLAD_WRAP_VOID(PFNGLDRAWARRAYSINSTANCEDPROC, DrawArraysInstanced, (GLenum mode, GLint first, GLsizei count, GLsizei instancecount), (mode, first, count, instancecount))
+GLAD_WRAP_VOID(PFNGLDRAWELEMENTSPROC, DrawElements, (GLenum mode, GLsizei count, GLenum type, const void* indices), (mode, count, type, indices))
+GLAD_WRAP_VOID(PFNGLDRAWELEMENTSINSTANCEDPROC, DrawElementsInstanced, (GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount), (mode, count, type, indices, instancecount))
+GLAD_WRAP_VOID(PFNGLENABLEPROC, Enable, (GLenum cap), (cap))
+GLAD_WRAP_VOID(PFNGLENABLEVERTEXATTRIBARRAYPROC, EnableVertexAttribArray, (GLuint index), (index))
+GLAD_WRAP_RETURN(PFNGLFENCESYNCPROC, GLsync, FenceSync, (GLenum condition, GLbitfield flags), (condition, flags))
+GLAD_WRAP_VOID(PFNGLFINISHPROC, Finish, (void), ())
+GLAD_WRAP_VOID(PFNGLFLUSHPROC, Flush, (void), ())
+GLAD_WRAP_VOID(PFNGLGENERATEMIPMAPPROC, GenerateMipmap, (GLenum target), (target))
+GLAD_WRAP_VOID(PFNGLGETQUERYOBJECTIVPROC, GetQueryObjectiv, (GLuint id, GLenum pname, GLint* params), (id, pname, params))
+GLAD_WRAP_VOID(PFNGLGETQUERYOBJECTUI64VPROC, GetQueryObjectui64v, (GLuint id, GLenum pname, GLuint64* params), (id, pname, params))
+GLAD_WRAP_RETURN(PFNGLGETUNIFORMLOCATIONPROC, GLint, GetUniformLocation, (GLuint program, const GLchar* name), (program, name))
+GLAD_WRAP_RETURN(PFNGLMAPBUFFERRANGEPROC, void*, MapBufferRange, (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access), (target, offset, length, access))
+GLAD_WRAP_VOID(PFNGLPIXELSTOREIPROC, PixelStorei, (GLenum pname, GLint param), (pname, param))
+GLAD_WRAP_VOID(PFNGLPOLYGONMODEPROC, PolygonMode, (GLenum face, GLenum mode), (face, mode))
+GLAD_WRAP_VOID(PFNGLQUERYCOUNTERPROC, QueryCounter, (GLuint id, GLenum target), (id, target))
+GLAD_WRAP_VOID(PFNGLTEXIMAGE2DPROC, TexImage2D, (GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels), (target, level, internalformat, width, height, border, format, type, pixels))
+GLAD_WRAP_VOID(PFNGLTEXIMAGE3DPROC, TexImage3D, (GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const void* pixels), (target, level, internalformat, width, height, depth, border, format, type, pixels))
+GLAD_WRAP_VOID(PFNGLTEXPARAMETERIPROC, TexParameteri, (GLenum target, GLenum pname, GLint param), (target, pname, param))
+GLAD_WRAP_VOID(PFNGLTEXSUBIMAGE2DPROC, TexSubImage2D, (GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels), (target, level, xoffset, yoffset, width, height, format, type, pixels))
+GLAD_WRAP_VOID(PFNGLTEXSUBIMAGE3DPROC, TexSubImage3D, (GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels), (target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, pixels))
+GLAD_WRAP_RETURN(PFNGLUNMAPBUFFERPROC, GLboolean, UnmapBuffer, (GLenum target), (target))
+GLAD_WRAP_VOID(PFNGLVERTEXATTRIBPOINTERPROC, VertexAttribPointer, (GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer), (index, size, type, normalized, stride, pointer))
+GLAD_WRAP_VOID(PFNGLVIEWPORTPROC, Viewport, (GLint x, GLint y, GLsizei width, GLsizei height), (x, y, width, height))
+
+/* Shadow state for the redundancy checks, GLAD_UNKNOWN means we have not seen the value yet */
+#define GLAD_UNKNOWN 0xFFFFFFFFu
+#define GLAD_MAX_TEXTURE_UNITS 32
+#define GLAD_MAX_BUFFER_TARGETS 8
+#define GLAD_UNIFORM_SHADOW_SIZE 4096
+#define GLAD_UNIFORM_MAX_FLOATS 16
+
+static GLuint glad_shadow_program = GLAD_UNKNOWN;
+static GLuint glad_shadow_vertex_array = GLAD_UNKNOWN;
+static GLenum glad_shadow_active_texture = GLAD_UNKNOWN;
+static GLuint glad_shadow_textures[GLAD_MAX_TEXTURE_UNITS][4];
+static GLenum glad_shadow_buffer_targets[GLAD_MAX_BUFFER_TARGETS];
+static GLuint glad_shadow_buffers[GLAD_MAX_BUFFER_TARGETS];
+
+typedef struct GLADuniformShadow {
+    GLuint program;
+    GLint location;
+    unsigned int size;
+    unsigned char value[GLAD_UNIFORM_MAX_FLOATS * 4];
+} GLADuniformShadow;
+
+static GLADuniformShadow glad_shadow_uniforms[GLAD_UNIFORM_SHADOW_SIZE];
+
+static void glad_instrument_reset_shadow(void) {
+    unsigned int i, j;
+    glad_shadow_program = GLAD_UNKNOWN;
+    glad_shadow_vertex_array = GLAD_UNKNOWN;
+    glad_shadow_active_texture = GLAD_UNKNOWN;
+    for(i = 0; i < GLAD_MAX_TEXTURE_UNITS; i++) {
+        for(j = 0; j < 4; j++) glad_shadow_textures[i][j] = GLAD_UNKNOWN;
+    }
+    for(i = 0; i < GLAD_MAX_BUFFER_TARGETS; i++) {
+        glad_shadow_buffer_targets[i] = 0;
+        glad_shadow_buffers[i] = GLAD_UNKNOWN;
+    }
+    memset(glad_shadow_uniforms, 0, sizeof(glad_shadow_uniforms));
+}
+
+/* Stores the new value and returns 1 if it equals the previous one */
+static int glad_shadow_compare_and_set(GLuint* slot, GLuint value) {
+    int redundant = *slot == value;
+    *slot = value;
+    return redundant;
+}
+
+static GLuint* glad_shadow_texture(GLenum target) {
+    unsigned int unit = glad_shadow_active_texture == GLAD_UNKNOWN ? 0 : glad_shadow_active_texture - GL_TEXTURE0;
+    unsigned int index;
+    switch(target) {
+        case GL_TEXTURE_2D: index = 0; break;
+        case GL_TEXTURE_2D_ARRAY: index = 1; break;
+        case GL_TEXTURE_CUBE_MAP: index = 2; break;
+        case GL_TEXTURE_3D: index = 3; break;
+        default: return NULL;
+    }
+    if(glad_shadow_active_texture == GLAD_UNKNOWN || unit >= GLAD_MAX_TEXTURE_UNITS) return NULL;
+    return &glad_shadow_textures[unit][index];
+}
+
+static GLuint* glad_shadow_buffer(GLenum target) {
+    unsigned int i;
+    for(i = 0; i < GLAD_MAX_BUFFER_TARGETS; i++) {
+        if(glad_shadow_buffer_targets[i] == target) return &glad_shadow_buffers[i];
+        if(glad_shadow_buffer_targets[i] == 0) {
+            glad_shadow_buffer_targets[i] = target;
+            return &glad_shadow_buffers[i];
+        }
+    }
+    return NULL;
+}
+
+/* Returns 1 if the location of the current program already holds exactly these bytes */
+static int glad_shadow_uniform(GLint location, const void* value, unsigned int size) {
+    unsigned int hash, probe;
+    if(glad_shadow_program == GLAD_UNKNOWN || location < 0 || size > sizeof(glad_shadow_uniforms[0].value)) return 0;
+
+    hash = (glad_shadow_program * 2654435761u) ^ ((unsigned int)location * 40503u);
+    for(probe = 0; probe < 16; probe++) {
+        GLADuniformShadow* shadow = &glad_shadow_uniforms[(hash + probe) & (GLAD_UNIFORM_SHADOW_SIZE - 1)];
+        if(shadow->size == 0) {
+            shadow->program = glad_shadow_program;
+            shadow->location = location;
+            shadow->size = size;
+            memcpy(shadow->value, value, size);
+            return 0;
+        }
+        if(shadow->program == glad_shadow_program && shadow->location == location) {
+            int redundant = shadow->size == size && memcmp(shadow->value, value, size) == 0;
+            shadow->size = size;
+            memcpy(shadow->value, value, size);
+            return redundant;
+        }
+    }
+    return 0;
+}
+
+static PFNGLUSEPROGRAMPROC glad_orig_glUseProgram;
+static void APIENTRY glad_instrumented_glUseProgram(GLuint program) {
+    double start;
+    if(glad_shadow_compare_and_set(&glad_shadow_program, program)) glad_current_frame.redundantBinds++;
+    start = glad_instrument_now();
+    glad_orig_glUseProgram(program);
+    glad_instrument_record(GLAD_STAT_UseProgram, start);
+}
+
+/* Marks the uniform shadows of a program as unknown. The entries stay in the table with a size no
+   uniform can have, an empty entry would end the probing for the entries after it. */
+static void glad_shadow_forget_uniforms(GLuint program) {
+    unsigned int i;
+    for(i = 0; i < GLAD_UNIFORM_SHADOW_SIZE; i++) {
+        if(glad_shadow_uniforms[i].size != 0 && glad_shadow_uniforms[i].program == program) glad_shadow_uniforms[i].size = GLAD_UNIFORM_MAX_FLOATS * 4 + 1;
+    }
+}
+
+static PFNGLLINKPROGRAMPROC glad_orig_glLinkProgram;
+static void APIENTRY glad_instrumented_glLinkProgram(GLuint program) {
+    double start;
+    /* linking resets all uniforms of the program to their defaults */
+    glad_shadow_forget_uniforms(program);
+    start = glad_instrument_now();
+    glad_orig_glLinkProgram(program);
+    glad_instrument_record(GLAD_STAT_LinkProgram, start);
+}
+
+static PFNGLPROGRAMBINARYPROC glad_orig_glProgramBinary;
+static void APIENTRY glad_instrumented_glProgramBinary(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length) {
+    double start;
+    /* loading a binary links the program like glLinkProgram does */
+    glad_shadow_forget_uniforms(program);
+    start = glad_instrument_now();
+    glad_orig_glProgramBinary(program, binaryFormat, binary, length);
+    glad_instrument_record(GLAD_STAT_ProgramBinary, start);
+}
+
+static PFNGLDELETEPROGRAMPROC glad_orig_glDeleteProgram;
+static void APIENTRY glad_instrumented_glDeleteProgram(GLuint program) {
+    double start;
+    /* the name can be handed out again to a new program */
+    if(program != 0) {
+        glad_shadow_forget_uniforms(program);
+        if(glad_shadow_program == program) glad_shadow_program = GLAD_UNKNOWN;
+    }
+    start = glad_instrument_now();
+    glad_orig_glDeleteProgram(program);
+    glad_instrument_record(GLAD_STAT_DeleteProgram, start);
+}
+
+static PFNGLBINDVERTEXARRAYPROC glad_orig_glBindVertexArray;
+static void APIENTRY glad_instrumented_glBindVertexArray(GLuint array) {
+    double start;
+    GLuint* elementBuffer;
+    if(glad_shadow_compare_and_set(&glad_shadow_vertex_array, array)) {
+        glad_current_frame.redundantBinds++;
+    } else {
+        /* the element array binding is part of the vertex array state */
+        elementBuffer = glad_shadow_buffer(GL_ELEMENT_ARRAY_BUFFER);
+        if(elementBuffer != NULL) *elementBuffer = GLAD_UNKNOWN;
+    }
+    start = glad_instrument_now();
+    glad_orig_glBindVertexArray(array);
+    glad_instrument_record(GLAD_STAT_BindVertexArray, start);
+}
+
+static PFNGLDELETEVERTEXARRAYSPROC glad_orig_glDeleteVertexArrays;
+static void APIENTRY glad_instrumented_glDeleteVertexArrays(GLsizei n, const GLuint* arrays) {
+    double start;
+    GLsizei i;
+    GLuint* elementBuffer;
+    /* deleting the bound vertex array binds 0, which brings its own element array binding */
+    for(i = 0; i < n; i++) {
+        if(arrays[i] != 0 && arrays[i] == glad_shadow_vertex_array) {
+            glad_shadow_vertex_array = GLAD_UNKNOWN;
+            elementBuffer = glad_shadow_buffer(GL_ELEMENT_ARRAY_BUFFER);
+            if(elementBuffer != NULL) *elementBuffer = GLAD_UNKNOWN;
+        }
+    }
+    start = glad_instrument_now();
+    glad_orig_glDeleteVertexArrays(n, arrays);
+    glad_instrument_record(GLAD_STAT_DeleteVertexArrays, start);
+}
+
+static PFNGLBINDBUFFERPROC glad_orig_glBindBuffer;
+static void APIENTRY glad_instrumented_glBindBuffer(GLenum target, GLuint buffer) {
+    double start;
+    GLuint* slot = glad_shadow_buffer(target);
+    if(slot != NULL && glad_shadow_compare_and_set(slot, buffer)) glad_current_frame.redundantBinds++;
+    start = glad_instrument_now();
+    glad_orig_glBindBuffer(target, buffer);
+    glad_instrument_record(GLAD_STAT_BindBuffer, start);
+}
+
+static PFNGLDELETEBUFFERSPROC glad_orig_glDeleteBuffers;
+static void APIENTRY glad_instrumented_glDeleteBuffers(GLsizei n, const GLuint* buffers) {
+    double start;
+    GLsizei i;
+    unsigned int j;
+    /* a deleted buffer is unbound from every target, and its name can be handed out again */
+    for(i = 0; i < n; i++) {
+        if(buffers[i] == 0) continue;
+        for(j = 0; j < GLAD_MAX_BUFFER_TARGETS; j++) {
+            if(glad_shadow_buffers[j] == buffers[i]) glad_shadow_buffers[j] = GLAD_UNKNOWN;
+        }
+    }
+    start = glad_instrument_now();
+    glad_orig_glDeleteBuffers(n, buffers);
+    glad_instrument_record(GLAD_STAT_DeleteBuffers, start);
+}
+
+static PFNGLACTIVETEXTUREPROC glad_orig_glActiveTexture;
+static void APIENTRY glad_instrumented_glActiveTexture(GLenum texture) {
+    double start;
+    if(glad_shadow_compare_and_set(&glad_shadow_active_texture, texture)) glad_current_frame.redundantBinds++;
+    start = glad_instrument_now();
+    glad_orig_glActiveTexture(texture);
+    glad_instrument_record(GLAD_STAT_ActiveTexture, start);
+}
+
+static PFNGLBINDTEXTUREPROC glad_orig_glBindTexture;
+static void APIENTRY glad_instrumented_glBindTexture(GLenum target, GLuint texture) {
+    double start;
+    GLuint* slot = glad_shadow_texture(target);
+    if(slot != NULL && glad_shadow_compare_and_set(slot, texture)) glad_current_frame.redundantBinds++;
+    start = glad_instrument_now();
+    glad_orig_glBindTexture(target, texture);
+    glad_instrument_record(GLAD_STAT_BindTexture, start);
+}
+
+static PFNGLDELETETEXTURESPROC glad_orig_glDeleteTextures;
+static void APIENTRY glad_instrumented_glDeleteTextures(GLsizei n, const GLuint* textures) {
+    double start;
+    GLsizei i;
+    unsigned int unit, index;
+    /* a deleted texture is unbound from every unit, and its name can be handed out again */
+    for(i = 0; i < n; i++) {
+        if(textures[i] == 0) continue;
+        for(unit = 0; unit < GLAD_MAX_TEXTURE_UNITS; unit++) {
+            for(index = 0; index < 4; index++) {
+                if(glad_shadow_textures[unit][index] == textures[i]) glad_shadow_textures[unit][index] = GLAD_UNKNOWN;
+            }
+        }
+    }
+    start = glad_instrument_now();
+    glad_orig_glDeleteTextures(n, textures);
+    glad_instrument_record(GLAD_STAT_DeleteTextures, start);
+}
+
+#define GLAD_WRAP_UNIFORM(type, name, params, args, value, size) \
+    static type glad_orig_gl##name; \
+    static void APIENTRY glad_instrumented_gl##name params { \
+        double start; \
+        if(glad_shadow_uniform(location, value, size)) glad_current_frame.redundantUniforms++; \
+        start = glad_instrument_now(); \
+        glad_orig_gl##name args; \
+        glad_instrument_record(GLAD_STAT_##name, start); \
+    }
+
+GLAD_WRAP_UNIFORM(PFNGLUNIFORM1IPROC, Uniform1i, (GLint location, GLint v0), (location, v0), &v0, sizeof(GLint))
+GLAD_WRAP_UNIFORM(PFNGLUNIFORM1FPROC, Uniform1f, (GLint location, GLfloat v0), (location, v0), &v0, sizeof(GLfloat))
+GLAD_WRAP_UNIFORM(PFNGLUNIFORM3FVPROC, Uniform3fv, (GLint location, GLsizei count, const GLfloat* value), (location, count, value), value, count == 1 ? 3 * sizeof(GLfloat) : 0xFFFFu)
+GLAD_WRAP_UNIFORM(PFNGLUNIFORMMATRIX3FVPROC, UniformMatrix3fv, (GLint location, GLsizei count, GLboolean transpose, const GLfloat* value), (location, count, transpose, value), value, count == 1 && !transpose ? 9 * sizeof(GLfloat) : 0xFFFFu)
+GLAD_WRAP_UNIFORM(PFNGLUNIFORMMATRIX4FVPROC, UniformMatrix4fv, (GLint location, GLsizei count, GLboolean transpose, const GLfloat* value), (location, count, transpose, value), value, count == 1 && !transpose ? 16 * sizeof(GLfloat) : 0xFFFFu)
+
+static PFNGLUNIFORM3FPROC glad_orig_glUniform3f;
+static void APIENTRY glad_instrumented_glUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {
+    double start;
+    GLfloat value[3];
+    value[0] = v0; value[1] = v1; value[2] = v2;
+    /* glUniform3f and glUniform3fv write the same state, so they share the shadow entry */
+    if(glad_shadow_uniform(location, value, sizeof(value))) glad_current_frame.redundantUniforms++;
+    start = glad_instrument_now();
+    glad_orig_glUniform3f(location, v0, v1, v2);
+    glad_instrument_record(GLAD_STAT_Uniform3f, start);
+}
+
+int gladInstrumentInstall(void) {
+    if(glad_instrument_installed) return 1;
+    if(glad_glGetString == NULL) return 0;
+
+    glad_instrument_reset_shadow();
+#define GLAD_INSTALL(name) \
+    if(glad_gl##name != NULL) { glad_orig_gl##name = glad_gl##name; glad_gl##name = glad_instrumented_gl##name; }
+    GLAD_INSTRUMENTED_FUNCTIONS(GLAD_INSTALL)
+#undef GLAD_INSTALL
+
+    glad_instrument_installed = 1;
+    return 1;
+}
+
+int gladInstrumentInstalled(void) {
+    return glad_instrument_installed;
+}
+
+void gladInstrumentEndFrame(void) {
+    unsigned int i;
+    for(i = 0; i < GLAD_STAT_COUNT; i++) {
+        glad_call_stats[i].frameCalls = glad_frame_calls[i];
+        glad_call_stats[i].frameSeconds = glad_frame_seconds[i];
+        glad_call_stats[i].totalCalls += glad_frame_calls[i];
+        glad_call_stats[i].totalSeconds += glad_frame_seconds[i];
+        glad_frame_calls[i] = 0;
+        glad_frame_seconds[i] = 0.0;
+    }
+    glad_last_frame = glad_current_frame;
+    memset(&glad_current_frame, 0, sizeof(glad_current_frame));
+}
+
+const GLADframeStats* gladInstrumentLastFrame(void) {
+    return &glad_last_frame;
+}
+
+unsigned int gladInstrumentEntryCount(void) {
+    return GLAD_STAT_COUNT;
+}
+
+const GLADcallStats* gladInstrumentEntry(unsigned int index) {
+    return index < GLAD_STAT_COUNT ? &glad_call_stats[index] : NULL;
+}
@@ -0,0 +1,51 @@
+#ifndef GLAD_INSTRUMENT_H
+#define GLAD_INSTRUMENT_H
+
+/*
+    Optional instrumented dispatch for the glad loader (implemented in glad.c).
+
+    gladInstrumentInstall() replaces the function pointers of the GL calls used in the render loop
+    with wrappers which count the calls per entry point, measure the CPU time spent inside the driver
+    and flag binds and uniform uploads which would not change any state. When it is not installed
+    the GL calls go straight to the driver and cost nothing extra.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct GLADcallStats {
+    const char* name;
+    /* calls and driver time of the last finished frame */
+    unsigned int frameCalls;
+    double frameSeconds;
+    /* calls and driver time since the wrappers were installed */
+    unsigned long long totalCalls;
+    double totalSeconds;
+} GLADcallStats;
+
+typedef struct GLADframeStats {
+    unsigned int calls;
+    /* glBind*, glUseProgram and glActiveTexture calls with the already bound object/unit */
+    unsigned int redundantBinds;
+    /* glUniform* calls uploading the value the location already holds */
+    unsigned int redundantUniforms;
+    double driverSeconds;
+} GLADframeStats;
+
+/* Call after gladLoadGLLoader, returns 0 if GL has not been loaded yet */
+int gladInstrumentInstall(void);
+int gladInstrumentInstalled(void);
+
+/* Closes the current frame, its numbers are available through the functions below until the next call */
+void gladInstrumentEndFrame(void);
+const GLADframeStats* gladInstrumentLastFrame(void);
+
+unsigned int gladInstrumentEntryCount(void);
+const GLADcallStats* gladInstrumentEntry(unsigned int index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
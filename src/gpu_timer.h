@@ -0,0 +1,164 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+#include <vector>
+
+#include "profiler.h"
+
+using namespace std;
+
+// Measures how long each render pass takes on the GPU with GL_TIMESTAMP queries (core since OpenGL 3.3).
+// The GPU runs a few frames behind the CPU, so the queries of a frame are kept in a ring of FRAME_LATENCY slots
+// and only read back when their slot is reused. If a result is still not available at that point it is dropped
+// instead of waiting, so glGetQueryObject never stalls the CPU.
+// Resolved passes are added to the profiler's "GPU" track and, while recording, collected for the benchmark report.
+class GpuTimer {
+public:
+	static const unsigned int FRAME_LATENCY = 4;
+
+	explicit GpuTimer(const vector<const char*>& passNames) : passNames(passNames), samples(passNames.size()) {
+		queries.resize(FRAME_LATENCY * passNames.size() * 2);
+		glGenQueries((GLsizei)queries.size(), queries.data());
+		slots.resize(FRAME_LATENCY);
+
+		// GPU timestamps have their own time base, remember the offset to the profiler's clock
+		GLint64 gpuNow = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+		clockOffset = (int64_t)Profiler::now() - (int64_t)gpuNow;
+		track = &Profiler::instance().createTrack("GPU");
+	}
+
+	// Delete the queries, call this while the context is still current
+	void destroy() {
+		glDeleteQueries((GLsizei)queries.size(), queries.data());
+		queries.clear();
+	}
+
+	// Only frames started while recording end up in passSamples()
+	void setRecording(bool value) {
+		recording = value;
+	}
+
+	void beginFrame() {
+		slot = (slot + 1) % FRAME_LATENCY;
+		// The slot was last used FRAME_LATENCY frames ago, by now its results should be there
+		resolve(slot, false);
+		slots[slot] = Slot();
+		slots[slot].recorded = recording;
+	}
+
+	void begin(unsigned int pass) {
+		glQueryCounter(query(slot, pass, 0), GL_TIMESTAMP);
+	}
+
+	void end(unsigned int pass) {
+		glQueryCounter(query(slot, pass, 1), GL_TIMESTAMP);
+		slots[slot].issuedPasses |= 1u << pass;
+	}
+
+	// Reads back all outstanding queries, this waits for the GPU so only call it once rendering is done
+	void flush() {
+		for (unsigned int i = 1; i <= FRAME_LATENCY; i++) {
+			unsigned int oldest = (slot + i) % FRAME_LATENCY;
+			resolve(oldest, true);
+			slots[oldest] = Slot();
+		}
+	}
+
+	// The most recent resolved time of a pass in milliseconds
+	double lastTime(unsigned int pass) const {
+		return pass < lastTimes.size() ? lastTimes[pass] : 0.0;
+	}
+
+	// All times in milliseconds of a pass recorded with setRecording(true)
+	const vector<double>& passSamples(unsigned int pass) const {
+		return samples[pass];
+	}
+
+	// Frames whose results were not ready in time and got thrown away
+	unsigned int droppedFrames() const {
+		return dropped;
+	}
+
+	const vector<const char*> passNames;
+
+	// Times the enclosing scope as the given pass
+	class Scope {
+	public:
+		Scope(GpuTimer& timer, unsigned int pass) : timer(timer), pass(pass) {
+			timer.begin(pass);
+		}
+		~Scope() {
+			timer.end(pass);
+		}
+	private:
+		GpuTimer& timer;
+		unsigned int pass;
+	};
+
+private:
+	struct Slot {
+		unsigned int issuedPasses = 0;
+		bool recorded = false;
+	};
+
+	vector<unsigned int> queries;
+	vector<Slot> slots;
+	vector<vector<double>> samples;
+	vector<double> lastTimes;
+	unsigned int slot = 0;
+	unsigned int dropped = 0;
+	bool recording = false;
+	int64_t clockOffset = 0;
+	ProfileRingBuffer* track = NULL;
+
+	unsigned int query(unsigned int frameSlot, unsigned int pass, unsigned int which) {
+		return queries[(frameSlot * passNames.size() + pass) * 2 + which];
+	}
+
+	void resolve(unsigned int frameSlot, bool wait) {
+		const Slot& data = slots[frameSlot];
+		if (data.issuedPasses == 0) {
+			return;
+		}
+
+		if (!wait) {
+			// Queries complete in order, so checking the last one of the frame is enough
+			for (unsigned int pass = (unsigned int)passNames.size(); pass-- > 0;) {
+				if (data.issuedPasses & (1u << pass)) {
+					GLint available = 0;
+					glGetQueryObjectiv(query(frameSlot, pass, 1), GL_QUERY_RESULT_AVAILABLE, &available);
+					if (!available) {
+						dropped++;
+						return;
+					}
+					break;
+				}
+			}
+		}
+
+		lastTimes.resize(passNames.size(), 0.0);
+		for (unsigned int pass = 0; pass < passNames.size(); pass++) {
+			if (!(data.issuedPasses & (1u << pass))) {
+				continue;
+			}
+			GLuint64 start = 0, end = 0;
+			glGetQueryObjectui64v(query(frameSlot, pass, 0), GL_QUERY_RESULT, &start);
+			glGetQueryObjectui64v(query(frameSlot, pass, 1), GL_QUERY_RESULT, &end);
+
+			lastTimes[pass] = (end - start) / 1000000.0;
+			if (data.recorded) {
+				samples[pass].push_back(lastTimes[pass]);
+			}
+			if (Profiler::instance().isEnabled()) {
+				track->push(passNames[pass], (uint64_t)((int64_t)start + clockOffset), (uint64_t)((int64_t)end + clockOffset));
+			}
+		}
+	}
+};
+
+#define GPU_ZONE(timer, pass) GpuTimer::Scope PROFILE_CONCAT(gpuZone, __LINE__)(timer, pass)
+
+#endif
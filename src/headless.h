@@ -0,0 +1,131 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <iostream>
+
+using namespace std;
+
+// Creates an OpenGL 3.3 core context without any window or display server.
+// Mesa exposes a "surfaceless" EGL platform which works with the llvmpipe software rasterizer,
+// so this also runs on machines without a GPU. Since there is no default framebuffer
+// everything has to be rendered into a framebuffer object (see OffscreenTarget below).
+class HeadlessContext {
+public:
+	EGLDisplay display = EGL_NO_DISPLAY;
+	EGLContext context = EGL_NO_CONTEXT;
+
+	bool create() {
+		// Prefer the surfaceless platform, fall back to the default display if the extension is missing
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay) {
+			display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+		}
+		if (display == EGL_NO_DISPLAY) {
+			display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		}
+
+		EGLint major, minor;
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+			cout << "ERROR::HEADLESS::EGL_INITIALIZATION_FAILED" << endl;
+			return false;
+		}
+
+		// We want desktop OpenGL and not OpenGL ES
+		if (!eglBindAPI(EGL_OPENGL_API)) {
+			cout << "ERROR::HEADLESS::OPENGL_API_NOT_SUPPORTED" << endl;
+			return false;
+		}
+
+		// We don't need a surface, but we still ask for a config so the context gets a sane pixel format
+		EGLint configAttributes[] = {
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_SURFACE_TYPE, 0,
+			EGL_NONE
+		};
+		EGLConfig config = NULL;
+		EGLint numberOfConfigs = 0;
+		eglChooseConfig(display, configAttributes, &config, 1, &numberOfConfigs);
+
+		// Use OPENGL3.3 core profile just like the GLFW window
+		EGLint contextAttributes[] = {
+			EGL_CONTEXT_MAJOR_VERSION, 3,
+			EGL_CONTEXT_MINOR_VERSION, 3,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+		context = eglCreateContext(display, numberOfConfigs > 0 ? config : (EGLConfig)0, EGL_NO_CONTEXT, contextAttributes);
+		if (context == EGL_NO_CONTEXT) {
+			cout << "ERROR::HEADLESS::CONTEXT_CREATION_FAILED" << endl;
+			return false;
+		}
+
+		// Make the context current without any draw or read surface
+		if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+			cout << "ERROR::HEADLESS::MAKE_CURRENT_FAILED" << endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	void destroy() {
+		if (display != EGL_NO_DISPLAY) {
+			eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			if (context != EGL_NO_CONTEXT) {
+				eglDestroyContext(display, context);
+			}
+			eglTerminate(display);
+		}
+		display = EGL_NO_DISPLAY;
+		context = EGL_NO_CONTEXT;
+	}
+
+	// Same signature as glfwGetProcAddress so it can be handed to gladLoadGLLoader
+	static void* getProcAddress(const char* name) {
+		return (void*)eglGetProcAddress(name);
+	}
+};
+
+// A framebuffer object with a color and a depth attachment which replaces the window's default framebuffer
+class OffscreenTarget {
+public:
+	unsigned int framebuffer = 0;
+	unsigned int colorBuffer = 0;
+	unsigned int depthBuffer = 0;
+
+	bool create(unsigned int width, unsigned int height) {
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+		glGenRenderbuffers(1, &colorBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+
+		glGenRenderbuffers(1, &depthBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			cout << "ERROR::HEADLESS::FRAMEBUFFER_INCOMPLETE" << endl;
+			return false;
+		}
+
+		// Leave the framebuffer bound so all following draw calls end up in it
+		return true;
+	}
+
+	void destroy() {
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteRenderbuffers(1, &colorBuffer);
+		glDeleteRenderbuffers(1, &depthBuffer);
+		glDeleteFramebuffers(1, &framebuffer);
+	}
+};
+
+#endif
@@ -1,24 +1,170 @@
 #include <iostream>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
 
 #include <glad/glad.h>
+#ifndef LEARNOPENGL_NO_GLFW
 #include <GLFW/glfw3.h>
+#endif
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include "shader.h"
 #include "stb_image.h"
+#include "benchmark.h"
+#include "profiler.h"
+#include "gpu_timer.h"
+#include "glad_instrument.h"
+#include "frame_uniforms.h"
+#include "shader_watcher.h"
+#include "texture_manager.h"
+#include "texture_packer.h"
+#include "transform_batch.h"
+#include "mesh_optimizer.h"
+#include "mesh_cache.h"
+#include "vertex_layout.h"
+#ifdef LEARNOPENGL_HEADLESS
+#include "headless.h"
+#endif
 
 using namespace std;
 
-// Declarations
-unsigned int loadTexture(char const* path);
-
 // Settings
 const unsigned int SCREEN_WIDTH = 800;
 const unsigned int SCREEN_HEIGHT = 600;
 
+// Vertices as they are stored in the vertex buffers. The vertex arrays in main() hold the same attributes as floats.
+// Half float positions, unorm16 texture coordinates and 10 bit normals
+struct CubeVertex {
+	uint16_t position[3];
+	uint16_t padding;
+	uint16_t texCoords[2];
+	uint32_t normal;
+};
+using CubeLayout = VertexLayout<Position3h, TexCoord2unorm16, Normal3snorm10>;
+static_assert(CubeLayout::matches<CubeVertex>(offsetof(CubeVertex, position), offsetof(CubeVertex, texCoords), offsetof(CubeVertex, normal)), "CubeVertex doesn't match CubeLayout");
+
+// The quads have no normals
+struct QuadVertex {
+	uint16_t position[3];
+	uint16_t padding;
+	uint16_t texCoords[2];
+};
+using QuadLayout = VertexLayout<Position3h, TexCoord2unorm16>;
+static_assert(QuadLayout::matches<QuadVertex>(offsetof(QuadVertex, position), offsetof(QuadVertex, texCoords)), "QuadVertex doesn't match QuadLayout");
+
+// Meshes loaded from files keep full precision positions and texture coordinates outside of [0, 1]
+struct MeshVertex {
+	float position[3];
+	float texCoords[2];
+	uint32_t normal;
+};
+using MeshLayout = VertexLayout<Position3f, TexCoord2f, Normal3snorm10>;
+static_assert(MeshLayout::matches<MeshVertex>(offsetof(MeshVertex, position), offsetof(MeshVertex, texCoords), offsetof(MeshVertex, normal)), "MeshVertex doesn't match MeshLayout");
+
+// Command line options
+struct Options {
+	// Render into a framebuffer object of an offscreen EGL context instead of a window
+	bool headless = false;
+	// Exit after this many frames, 0 means run until the window is closed
+	unsigned int frames = 0;
+	// Run a deterministic benchmark and write the JSON report to this path
+	const char* benchmarkReport = NULL;
+	// Frames rendered before the benchmark starts measuring
+	unsigned int warmupFrames = 60;
+	// Write the profiler zones as Chrome trace to this path on exit
+	const char* traceFile = NULL;
+	// Count and time every GL call through the instrumented glad dispatch
+	bool glStats = false;
+	// Number of lit cubes, more than the 10 hand placed ones are scattered in front of the camera to stress the renderer
+	unsigned int cubes = 10;
+	// Draw this .obj or .glb mesh instead of the lit cubes
+	const char* mesh = NULL;
+	// Decode all textures, bake them into the texture cache and exit
+	bool bakeTextures = false;
+	// How the baked textures are compressed
+	TextureCompression textureCompression = TEXTURE_COMPRESSION_NORMAL;
+	// How the mip levels of the baked textures are filtered
+	MipFilter mipFilter = MIP_FILTER_KAISER;
+};
+
+Options parseOptions(int argc, char** argv) {
+	Options options;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--headless") == 0) {
+			options.headless = true;
+		} else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			options.frames = (unsigned int)strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--benchmark") == 0 && i + 1 < argc) {
+			options.benchmarkReport = argv[++i];
+		} else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+			options.warmupFrames = (unsigned int)strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+			options.traceFile = argv[++i];
+		} else if (strcmp(argv[i], "--gl-stats") == 0) {
+			options.glStats = true;
+		} else if (strcmp(argv[i], "--cubes") == 0 && i + 1 < argc) {
+			options.cubes = (unsigned int)strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--mesh") == 0 && i + 1 < argc) {
+			options.mesh = argv[++i];
+		} else if (strcmp(argv[i], "--bake-textures") == 0) {
+			options.bakeTextures = true;
+		} else if (strcmp(argv[i], "--mip-filter") == 0 && i + 1 < argc) {
+			options.mipFilter = strcmp(argv[++i], "box") == 0 ? MIP_FILTER_BOX : MIP_FILTER_KAISER;
+		} else if (strcmp(argv[i], "--texture-compression") == 0 && i + 1 < argc) {
+			const char* quality = argv[++i];
+			if (strcmp(quality, "off") == 0) {
+				options.textureCompression = TEXTURE_COMPRESSION_OFF;
+			} else if (strcmp(quality, "fast") == 0) {
+				options.textureCompression = TEXTURE_COMPRESSION_FAST;
+			} else if (strcmp(quality, "best") == 0) {
+				options.textureCompression = TEXTURE_COMPRESSION_BEST;
+			} else {
+				options.textureCompression = TEXTURE_COMPRESSION_NORMAL;
+			}
+		} else {
+			cout << "Unknown option: " << argv[i] << endl;
+			cout << "Usage: LearnOpenGL [--headless] [--frames N] [--benchmark report.json] [--warmup N] [--trace trace.json] [--gl-stats] [--cubes N] [--mesh file.obj|file.glb] [--bake-textures] [--texture-compression off|fast|normal|best] [--mip-filter box|kaiser]" << endl;
+		}
+	}
+	// Without a window nobody can close the application, so always stop after a fixed amount of frames
+	if ((options.headless || options.benchmarkReport != NULL) && options.frames == 0) {
+		options.frames = 100;
+	}
+	return options;
+}
 
+// Render passes timed on the GPU
+enum RenderPass {
+	PASS_CUBES,
+	PASS_LIGHT_SOURCE_CUBE,
+	PASS_TRANSPARENT_GEOMETRY
+};
+
+// Print how often every GL entry point was called per frame and how long the driver took
+void printGLStats(unsigned int frames) {
+	cout << "GL calls per frame (average over " << frames << " frames):" << endl;
+	for (unsigned int i = 0; i < gladInstrumentEntryCount(); i++) {
+		const GLADcallStats* entry = gladInstrumentEntry(i);
+		if (entry->totalCalls > 0) {
+			cout << "  " << entry->name << ": " << (double)entry->totalCalls / frames << " calls, "
+				<< entry->totalSeconds * 1000.0 / frames << " ms" << endl;
+		}
+	}
+	const GLADframeStats* last = gladInstrumentLastFrame();
+	cout << "Last frame: " << last->calls << " calls, " << last->redundantBinds << " redundant binds, "
+		<< last->redundantUniforms << " redundant uniform uploads" << endl;
+}
+
+// Seconds since the first call, works with and without a GLFW window
+double getTime() {
+	static chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+#ifndef LEARNOPENGL_NO_GLFW
 void resizeViewport(GLFWwindow* window, int width, int height) {
 	glViewport(0, 0, width, height);
 }
@@ -28,33 +174,79 @@ void handleInput(GLFWwindow* window) {
 		glfwSetWindowShouldClose(window, true);
 	}
 }
+#endif
+
+int main(int argc, char** argv) {
+	Options options = parseOptions(argc, argv);
+	getTime();
+
+#ifndef LEARNOPENGL_NO_GLFW
+	GLFWwindow* window = NULL;
+#endif
+#ifdef LEARNOPENGL_HEADLESS
+	HeadlessContext headlessContext;
+	OffscreenTarget offscreenTarget;
+#endif
+
+	if (options.headless) {
+#ifdef LEARNOPENGL_HEADLESS
+		// Create a context without window, we render into a framebuffer object instead
+		if (!headlessContext.create()) {
+			cout << "Failed to create headless context!" << endl;
+			return -1;
+		}
+		if (!gladLoadGLLoader((GLADloadproc)HeadlessContext::getProcAddress)) {
+			cout << "Failed to initialize GLAD!" << endl;
+			return -1;
+		}
+		if (!offscreenTarget.create(SCREEN_WIDTH, SCREEN_HEIGHT)) {
+			return -1;
+		}
+#else
+		cout << "This build does not support --headless!" << endl;
+		return -1;
+#endif
+	} else {
+#ifndef LEARNOPENGL_NO_GLFW
+		// Initialize GLFW
+		glfwInit();
+		// Configure GLFW
+		// Use OPENGL3.3
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		// Use the OPENGL core profile (no backwards compatible features)
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+		// Create a new window object (OS dependent)
+		window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "LearnOpenGL", NULL, NULL);
+
+		if (window == NULL) {
+			cout << "Failed to create GLFW window!" << endl;
+			return -1;
+		}
+		// Make the context of the window the context on the current thread
+		glfwMakeContextCurrent(window);
+
+		// Before we call any OpenGL functions initialize GLAD
+		// GLAD manages function pointers for OpenGL
+		// We pass GLAD the function to load the address pof the OpenGL function pointers
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+			cout << "Failed to initialize GLAD!" << endl;
+			return -1;
+		}
 
-int main() {
-	// Initialize GLFW
-	glfwInit();
-	// Configure GLFW
-	// Use OPENGL3.3
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	// Use the OPENGL core profile (no backwards compatible features)
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-	
-	// Create a new window object (OS dependent)
-	GLFWwindow* window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "LearnOpenGL", NULL, NULL);
-
-	if (window == NULL) {
-		cout << "Failed to create GLFW window!" << endl;
+		// Register GLFW callbacks after we created the window and before the render loop
+		// Register the resize callback
+		glfwSetFramebufferSizeCallback(window, resizeViewport);
+#else
+		cout << "This build has no GLFW support, run it with --headless!" << endl;
 		return -1;
+#endif
 	}
-	// Make the context of the window the context on the current thread
-	glfwMakeContextCurrent(window);
-
-	// Before we call any OpenGL functions initialize GLAD
-	// GLAD manages function pointers for OpenGL
-	// We pass GLAD the function to load the address pof the OpenGL function pointers
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-		cout << "Failed to initialize GLAD!" << endl;
-		return -1;
+
+	// Route the GL calls through the counting wrappers of the glad loader
+	if (options.glStats) {
+		gladInstrumentInstall();
 	}
 
 	// Create the OpenGL viewport
@@ -65,26 +257,101 @@ int main() {
 	glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &numberOfVertexAttributes);
 	cout << "Maximum number of vertex attributes supported by hardware: " << numberOfVertexAttributes << endl;
 
-	// Register GLFW callbacks after we created the window and before the render loop
-	// Register the resize callback
-	glfwSetFramebufferSizeCallback(window, resizeViewport);
+	// All state changes go through the state cache which skips the calls that would not change anything
+	GLStateCache& glState = GLStateCache::instance();
 
 	// Draw meshes in wireframe mode
-	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+	//glState.setPolygonMode(GL_LINE);
 	// Draw meshes in filled mode
-	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	glState.setPolygonMode(GL_FILL);
 
 	// Enable Z-Buffer
-	glEnable(GL_DEPTH_TEST);
+	glState.setDepthTest(true);
 	// Enable Blending
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glState.setBlend(true);
+	glState.setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+
+	// LOADING & GENERATING TEXTURES
+	// The images are decoded on worker threads while the shaders compile and the geometry is built,
+	// until they are uploaded the textures show a placeholder.
+	// The handles are shared, acquiring an image twice returns the same texture
+	// Flip y axis of images so they are loaded correctly
+	// stbi_set_flip_vertically_on_load(true);
+	TextureManager& textureManager = TextureManager::instance();
+	// Baking offline replaces what is in the cache, otherwise images are only baked the first time they are used
+	TextureCache::instance().rebuild = options.bakeTextures;
+	TextureLoader::instance().compression = options.textureCompression;
+	TextureLoader::instance().mipFilter = options.mipFilter;
+	TextureHandle texture1 = textureManager.acquire("resources/textures/container.jpg");
+	TextureHandle texture2 = textureManager.acquire("resources/textures/awesomeface.png");
+	// The grass and the window are layers of one texture array, so the quads showing them are drawn with one call
+	vector<PackedTexture> quadTextures = TexturePacker::pack({ "resources/textures/grass.png", "resources/textures/window.png" });
 
 
 	// BUILD VERTEX AND FRAGMENT SHADERS
-	Shader shader("shaders/shader.vert", "shaders/shader.frag");
-	Shader lightShader("shaders/light.vert", "shaders/light.frag");
-	Shader blendShader("shaders/blend.vert", "shaders/blend.frag");
+	// All programs are submitted before any status is checked, so the driver can compile them at the same time
+	ShaderBatch shaderBatch;
+	ShaderVariantCache shaderVariants;
+	// The lighting constants are compiled into the program, every combination is its own variant
+	ShaderDefines lighting = { { "AMBIENT_STRENGTH", "0.2" }, { "SPECULAR_STRENGTH", "0.5" }, { "SHININESS", "32.0" } };
+	// All cubes are drawn with one instanced draw call, their matrices come from a vertex buffer
+	lighting.set("INSTANCED");
+	Shader& shader = shaderVariants.get("shaders/shader.vert", "shaders/shader.frag", lighting, &shaderBatch);
+	Shader& lightShader = shaderVariants.get("shaders/light.vert", "shaders/light.frag", ShaderDefines(), &shaderBatch);
+	// The quads are instanced too, every instance picks its layer of the texture array
+	ShaderDefines blending;
+	blending.set("INSTANCED");
+	blending.set("TEXTURE_ARRAY");
+	Shader& blendShader = shaderVariants.get("shaders/blend.vert", "shaders/blend.frag", blending, &shaderBatch);
+	shaderBatch.finish();
+
+	// View, projection, camera position and time are the same for all programs,
+	// so they live in one uniform buffer which is filled once per frame
+	FrameUniformBuffer frameUniforms;
+	frameUniforms.create();
+
+	// Resolve the uniforms used in the render loop once, so the loop never has to look up a location by name
+	UniformHandle<glm::vec3> objectColorUniform;
+	UniformHandle<glm::vec3> lightColorUniform;
+	UniformHandle<glm::vec3> lightPositionUniform;
+	UniformHandle<glm::mat4> lightModelUniform;
+	// Everything which belongs to a program object, this has to run again whenever a program is reloaded
+	auto setupPrograms = [&]() {
+		objectColorUniform = shader.uniform<glm::vec3>("objectColor");
+		lightColorUniform = shader.uniform<glm::vec3>("lightColor");
+		lightPositionUniform = shader.uniform<glm::vec3>("lightPosition");
+		lightModelUniform = lightShader.uniform<glm::mat4>("model");
+
+		shader.bindUniformBlock("FrameConstants", FrameUniformBuffer::BINDING);
+		lightShader.bindUniformBlock("FrameConstants", FrameUniformBuffer::BINDING);
+		blendShader.bindUniformBlock("FrameConstants", FrameUniformBuffer::BINDING);
+
+		// Activate the shader before setting texture uniforms
+		shader.use();
+		// Tell OpenGL to which texture unit each shader sampler belongs to
+		shader.setInt("texture1", 0);
+		shader.setInt("texture2", 1);
+
+		blendShader.use();
+		blendShader.setInt("texture1", 0);
+	};
+	setupPrograms();
+
+	// Pick up saved shader files while the application is running, only with a window since nobody edits
+	// shaders during a headless run
+	ShaderWatcher shaderWatcher;
+	vector<Shader*> programs = shaderVariants.programs();
+#ifndef LEARNOPENGL_NO_GLFW
+	if (window != NULL) {
+		for (Shader* program : programs) {
+			for (const string& file : program->dependencies) {
+				shaderWatcher.watch(file);
+			}
+		}
+		shaderWatcher.start();
+	}
+#endif
 
 
 	// Define position coordinates and texture coordinates of the vertices a cube
@@ -172,7 +439,61 @@ int main() {
 	// Define the position of the light source cube
 	glm::vec3 lightPostion(0.0f, 0.0f, -1.0f);
 
+	// LOAD A MESH
+	// With --mesh the lit objects are a mesh from a file instead of the box, scaled to the size of the box.
+	// The file is only parsed on the first run, after that the mesh is mapped from the mesh cache.
+	CachedMesh loadedMesh;
+	float objectScale = 1.0f;
+	// the center of the mesh's bounds, the objects rotate around it (glTF models usually have their origin at the feet)
+	glm::vec3 objectPivot(0.0f);
+	if (options.mesh != NULL) {
+		auto loadStart = chrono::steady_clock::now();
+		if (MeshCache::instance().load(options.mesh, MeshLayout::format(), loadedMesh)) {
+			chrono::duration<double, milli> loadTime = chrono::steady_clock::now() - loadStart;
+			glm::vec3 extent = loadedMesh.boundsMax - loadedMesh.boundsMin;
+			float largestExtent = max(extent.x, max(extent.y, extent.z));
+			if (largestExtent > 0.0f) {
+				objectScale = 1.0f / largestExtent;
+			}
+			objectPivot = (loadedMesh.boundsMin + loadedMesh.boundsMax) * 0.5f;
+			cout << "Mesh " << options.mesh << ": " << loadedMesh.vertexCount() << " vertices, " << loadedMesh.indexCount / 3
+				<< " triangles, " << (loadedMesh.fromCache ? "mapped from the cache" : "loaded") << " in " << loadTime.count() << " ms" << endl;
+		}
+	}
+
+	// The model and normal matrices of all objects are computed together once per frame,
+	// each object remembers where its matrices are in the batch
+	TransformBatch transforms;
+	unsigned int cubeTransforms = (unsigned int)transforms.size();
+	// A fixed seed, so every run (and every benchmark) gets the same cubes
+	unsigned int random = 12345;
+	auto randomFloat = [&random](float min, float max) {
+		random = random * 1664525u + 1013904223u;
+		return min + (max - min) * (random >> 8) / 16777216.0f;
+	};
+	for (unsigned int i = 0; i < options.cubes; i++) {
+		glm::vec3 position = i < 10 ? cubePositions[i] : glm::vec3(randomFloat(-40.0f, 40.0f), randomFloat(-30.0f, 30.0f), randomFloat(-80.0f, -5.0f));
+		// Rotate the cubes around the same axis, the angle is animated in the render loop
+		transforms.add(position, glm::vec3(1.0f, 0.3f, 0.5f), 0.0f, glm::vec3(objectScale), objectPivot);
+	}
+	// Shrink the light source cube
+	unsigned int lightTransform = transforms.add(lightPostion, glm::vec3(0.0f, 0.0f, 1.0f), 0.0f, glm::vec3(0.2f));
+	unsigned int transparentTransforms = (unsigned int)transforms.size();
+	for (unsigned int i = 0; i < 5; i++) {
+		transforms.add(transparentPositions[i]);
+	}
+	unsigned int semiTransparentTransform = transforms.add(semiTransparentPosition, glm::vec3(0.0f, 0.0f, 1.0f), 0.0f, glm::vec3(0.5f));
+	// the grass and the window are one instanced draw, their matrices follow each other
+	unsigned int quadCount = semiTransparentTransform - transparentTransforms + 1;
+
 	// CREATE A BOX
+	// The 36 vertices above repeat every corner a face shares, so we weld them into 24 unique vertices
+	// and an index buffer, then order the triangles for the post-transform cache
+	float acmrBefore = 0.0f, acmrAfter = 0.0f;
+	IndexedMesh cubeMesh = MeshOptimizer::build(vertices, sizeof(vertices) / (CubeLayout::sourceStride * sizeof(float)), CubeLayout::sourceStride, &acmrBefore, &acmrAfter);
+	cout << "Cube mesh: " << sizeof(vertices) / (CubeLayout::sourceStride * sizeof(float)) << " vertices welded to " << cubeMesh.vertexCount()
+		<< ", ACMR " << acmrBefore << " -> " << acmrAfter << endl;
+
 	// Bind Vertex Array Object
 	unsigned int VAO;
 	glGenVertexArrays(1, &VAO);
@@ -187,50 +508,67 @@ int main() {
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
 	// Copy the previously defined vertex data into the buffer's memory
 	// Store the vertex data within memory on the graphics card as managed by a vertex buffer object named VBO
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	// Store the vertices packed: half float positions, unorm16 texture coordinates and 10 bit normals
+	// make a vertex 16 instead of 32 bytes (the cube's values are exact in all of these formats)
+	vector<CubeVertex> cubeVertices = CubeLayout::pack<CubeVertex>(cubeMesh.vertices.data(), cubeMesh.vertexCount());
+	glBufferData(GL_ARRAY_BUFFER, cubeVertices.size() * sizeof(CubeVertex), cubeVertices.data(), GL_STATIC_DRAW);
+
+	// The element buffer holds the indices, its binding is stored in the vertex array object
+	unsigned int EBO;
+	glGenBuffers(1, &EBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, cubeMesh.indices.size() * sizeof(unsigned int), cubeMesh.indices.data(), GL_STATIC_DRAW);
+	GLsizei cubeIndexCount = (GLsizei)cubeMesh.indices.size();
 
 	// Set the vertex attributes pointers
 	// Tell OpenGL how it should interpret the vertex data
 	// We have to manually specify what part of our input data goes to which vertex attribute in the vertex shader
 
-	// Define the layout of the position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-	// Enable the position vertex attribute with glEnableVertexAttribArray giving the vertex attribute location as its argument (layout (location=0))
-	glEnableVertexAttribArray(0);
-
-	// Define the layout of the texture coordinates attribute
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-	// Enable the texture coordinates attribute
-	glEnableVertexAttribArray(1);
+	// The layout issues the glVertexAttribPointer and glEnableVertexAttribArray call of each attribute,
+	// with the stride and offsets computed at compile time
+	// A loaded mesh gets buffers of its own, the light source below keeps using the box
+	unsigned int meshVBO = 0;
+	unsigned int meshEBO = 0;
+	GLsizei objectIndexCount = cubeIndexCount;
+	if (loadedMesh.indexCount > 0) {
+		glGenBuffers(1, &meshVBO);
+		glBindBuffer(GL_ARRAY_BUFFER, meshVBO);
+		glBufferData(GL_ARRAY_BUFFER, loadedMesh.vertexBytes, loadedMesh.vertices, GL_STATIC_DRAW);
+		glGenBuffers(1, &meshEBO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshEBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, loadedMesh.indexCount * sizeof(unsigned int), loadedMesh.indices, GL_STATIC_DRAW);
+		objectIndexCount = (GLsizei)loadedMesh.indexCount;
+		MeshLayout::setup();
+		loadedMesh.release();
+	} else {
+		CubeLayout::setup();
+	}
 
-	// Define the layout of the normal coordinates attribute
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(5 * sizeof(float)));
-	// Enable the normal coordinates attribute
-	glEnableVertexAttribArray(2);
+	// CREATE THE INSTANCE BUFFER
+	// Holds the model matrices of all cubes followed by their normal matrices, refilled every frame.
+	// A matrix attribute takes one location per column, the model matrix uses the locations 3 to 6 and the
+	// normal matrix 7 to 9. With a divisor of 1 OpenGL moves to the next matrix once per instance instead of once per vertex.
+	unsigned int instanceVBO;
+	GLsizeiptr instanceModelsSize = options.cubes * sizeof(glm::mat4);
+	GLsizeiptr instanceNormalsSize = options.cubes * sizeof(glm::mat3);
+	glGenBuffers(1, &instanceVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, instanceModelsSize + instanceNormalsSize, NULL, GL_STREAM_DRAW);
+	for (unsigned int column = 0; column < 4; column++) {
+		glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(column * sizeof(glm::vec4)));
+		glEnableVertexAttribArray(3 + column);
+		glVertexAttribDivisor(3 + column, 1);
+	}
+	for (unsigned int column = 0; column < 3; column++) {
+		glVertexAttribPointer(7 + column, 3, GL_FLOAT, GL_FALSE, sizeof(glm::mat3), (void*)(instanceModelsSize + column * sizeof(glm::vec3)));
+		glEnableVertexAttribArray(7 + column);
+		glVertexAttribDivisor(7 + column, 1);
+	}
 
 	// Another way to fetch the location of the vertex atrribute in a shader
 	// cout << glGetAttribLocation(shaderProgram, "aPos") << endl;
 
 
-	// Flip y axis of images so they are loaded correctly
-	// stbi_set_flip_vertically_on_load(true);
-	
-	// LOADING & GENERATING TEXTURES
-	unsigned int texture1 = loadTexture("resources/textures/container.jpg");
-	unsigned int texture2 = loadTexture("resources/textures/awesomeface.png");
-	unsigned int texture3 = loadTexture("resources/textures/grass.png");
-	unsigned int texture4 = loadTexture("resources/textures/window.png");
-
-	// Activate the shader before setting texture uniforms
-	shader.use();
-	// Tell OpenGL to which texture unit each shader sampler belongs to
-	shader.setInt("texture1", 0);
-	shader.setInt("texture2", 1);
-
-	blendShader.use();
-	blendShader.setInt("texture1", 0);
-
-
 	// CREATE SOME TRANSPARENT GEOMETRY
 	unsigned int transparentVAO;
 	unsigned int transparentVBO;
@@ -238,57 +576,163 @@ int main() {
 	glGenBuffers(1, &transparentVBO);
 	glBindVertexArray(transparentVAO);
 	glBindBuffer(GL_ARRAY_BUFFER, transparentVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(transparentVertices), &transparentVertices, GL_STATIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-
-
-	// CREATE SOME SEMI-TRANSPARENT TEXTURE
-	unsigned int semiTransparentVAO;
-	glGenVertexArrays(1, &semiTransparentVAO);
-	glBindVertexArray(semiTransparentVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, transparentVBO);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+	// 12 instead of 20 bytes per vertex
+	vector<QuadVertex> quadVertices = QuadLayout::pack<QuadVertex>(transparentVertices, sizeof(transparentVertices) / (QuadLayout::sourceStride * sizeof(float)));
+	glBufferData(GL_ARRAY_BUFFER, quadVertices.size() * sizeof(QuadVertex), quadVertices.data(), GL_STATIC_DRAW);
+	QuadLayout::setup();
+
+	// Every quad is an instance with its model matrix and the layer its image is in, the grass first and the
+	// semi-transparent window last. Instances are blended in order, so one draw call keeps the order the window needs.
+	// Quads whose images ended up in different arrays can't share a call, each run of quads in the same array gets one.
+	struct QuadBatch {
+		TextureHandle array;
+		unsigned int first;
+		unsigned int count;
+	};
+	vector<QuadBatch> quadBatches;
+	vector<float> quadLayers;
+	for (unsigned int i = 0; i < quadCount; i++) {
+		const PackedTexture& image = i + transparentTransforms == semiTransparentTransform ? quadTextures[1] : quadTextures[0];
+		if (quadBatches.empty() || quadBatches.back().array != image.array) {
+			quadBatches.push_back({ image.array, i, 0 });
+		}
+		quadBatches.back().count++;
+		quadLayers.push_back((float)image.layer);
+	}
+	// The model matrices are refilled every frame, the layers never change
+	unsigned int quadInstanceVBO;
+	glGenBuffers(1, &quadInstanceVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, quadInstanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, quadCount * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+	unsigned int quadLayerVBO;
+	glGenBuffers(1, &quadLayerVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, quadLayerVBO);
+	glBufferData(GL_ARRAY_BUFFER, quadLayers.size() * sizeof(float), quadLayers.data(), GL_STATIC_DRAW);
+	// Points the instance attributes of the bound vertex array at the quad the draw starts with
+	auto pointQuadInstances = [&](unsigned int first) {
+		glState.bindBuffer(GL_ARRAY_BUFFER, quadInstanceVBO);
+		for (unsigned int column = 0; column < 4; column++) {
+			glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(first * sizeof(glm::mat4) + column * sizeof(glm::vec4)));
+			glEnableVertexAttribArray(3 + column);
+			glVertexAttribDivisor(3 + column, 1);
+		}
+		glState.bindBuffer(GL_ARRAY_BUFFER, quadLayerVBO);
+		glVertexAttribPointer(10, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)(first * sizeof(float)));
+		glEnableVertexAttribArray(10);
+		glVertexAttribDivisor(10, 1);
+	};
+	pointQuadInstances(0);
 
 
 	// CREATE A LIGHT SOURCE CUBE
 	unsigned int lightVAO;
 	glGenVertexArrays(1, &lightVAO);
 	glBindVertexArray(lightVAO);
-	// use the already created cube buffer for the light
+	// use the already created cube buffers for the light
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	// the light shader only reads the position, the other attributes are enabled but unused
+	CubeLayout::setup();
 
 	// Unbind vertex array
 	 glBindVertexArray(0);
 
+	// The setup above binds buffers and textures directly, so the cache can't trust what it knows
+	glState.invalidate();
+
+	// Headless and benchmark frames are compared and measured, so they must not depend on how fast the images decode
+	if (options.headless || options.benchmarkReport != NULL || options.bakeTextures) {
+		textureManager.finish();
+	}
+	if (options.bakeTextures) {
+		cout << "Baked " << TextureCache::instance().misses << " textures into " << TextureCache::instance().directory << endl;
+	}
+
+	// In benchmark mode the frames are measured after the warmup and animated with a fixed time step
+	bool benchmarking = options.benchmarkReport != NULL;
+	Benchmark benchmark(options.warmupFrames, options.frames);
+	FrameCounters counters;
+	GpuTimer gpuTimer({ "RenderCubes", "RenderLightSourceCube", "RenderTransparentGeometry" });
+
 	// Initialize the render loop
-	while (!glfwWindowShouldClose(window)) {
-		// INPUT
-		handleInput(window);
+	unsigned int frame = 0;
+	double loopStart = getTime();
+	while (!options.bakeTextures && (benchmarking ? !benchmark.done() : (options.frames == 0 || frame < options.frames))) {
+		PROFILE_ZONE("Frame");
+#ifndef LEARNOPENGL_NO_GLFW
+		if (window != NULL) {
+			if (glfwWindowShouldClose(window)) {
+				break;
+			}
+			// INPUT
+			PROFILE_ZONE("Input");
+			handleInput(window);
+		}
+#endif
+
+		if (benchmarking) {
+			benchmark.beginFrame();
+			gpuTimer.setRecording(benchmark.measuring());
+		}
+		gpuTimer.beginFrame();
+		counters = FrameCounters();
+
+		// SHADER HOT RELOAD
+		if (shaderWatcher.isRunning()) {
+			PROFILE_ZONE("ReloadShaders");
+			bool reloaded = false;
+			for (const ShaderFileChange& change : shaderWatcher.poll()) {
+				for (Shader* program : programs) {
+					if (program->uses(change.path) && program->reload(change.path, change.code)) {
+						reloaded = true;
+					}
+				}
+			}
+			if (reloaded) {
+				setupPrograms();
+			}
+		}
+		// TEXTURE STREAMING
+		// Uploads the textures decoded since the last frame
+		textureManager.update();
+
+		// The time used to animate the scene
+		double time = benchmarking ? benchmark.time() : getTime();
 
 		// RENDERING LOGIC
-		// Set the color which glClear will (state-setting function)
-		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-		// Actually clear the screen's color and depth buffer (state-using function)
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		{
+			PROFILE_ZONE("Clear");
+			// Set the color which glClear will (state-setting function)
+			glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+			// Actually clear the screen's color and depth buffer (state-using function)
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		}
 
 
-		// TEXTURES
-		// Activate the texture unit first before binding texture
-		// Most graphic drivers set default texture unit to 0 and you can skip this step if you only want to assign 1 texture
-		glActiveTexture(GL_TEXTURE0);
-		// Bind the texture and it will automatically assign it to the fragment shader's sampler
-		glBindTexture(GL_TEXTURE_2D, texture1);
+		// TRANSFORMATIONS
+		// Create View Matrix to transform world space to view (camera) space
+		glm::mat4 view = glm::mat4(1.0f);
+		view = glm::translate(view, glm::vec3(0.0f, 0.0f, -3.0f));
+		// Create Porjection Matrixs to transform view space to clip space
+		glm::mat4 projection = glm::mat4(1.0f);
+		projection = glm::perspective(glm::radians(45.0f), (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 0.1f, 100.0f);
 
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, texture2);
+		// Upload the matrices for all shaders at once
+		FrameConstants frameConstants;
+		frameConstants.view = view;
+		frameConstants.projection = projection;
+		// The camera position is the translation of the inverse view matrix
+		frameConstants.cameraPosition = glm::inverse(view)[3];
+		frameConstants.time = (float)time;
+		unsigned int uniformStalls = frameUniforms.stallCount();
+		frameUniforms.update(frameConstants);
+		counters.uniformStalls = frameUniforms.stallCount() - uniformStalls;
+
+		// Rotate the cubes and compute the matrices of all objects
+		for (unsigned int i = 0; i < options.cubes; i++) {
+			transforms.angle[cubeTransforms + i] = (float)time * glm::radians(20.0f * (i % 10 + 1));
+		}
+		transforms.update();
 
 
 		// When rendering semi tranparent objects the zbuffer cannot handle the sorting alone,
@@ -300,150 +744,165 @@ int main() {
 
 
 		// RENDER CUBES
-		glBindVertexArray(VAO);
-		// Activate shader programm object for the cubes
-		// Every shader and rendering call after glUseProgram will now use this program object (and thus the shaders)
-		shader.use();
-		// Setup object, lighting colors and position
-		shader.setVec3("objectColor", 1.0f, 0.5f, 0.31f);
-		shader.setVec3("lightColor", 1.0f, 1.0f, 1.0f);
-		shader.setVec3("lightPosition", lightPostion);
-		// The camera position is the inverse of the view matrix
-		shader.setVec3("cameraPosition", glm::vec3(0.0f, 0.0f, 3.0f));
-
-		// TRANSFORMATIONS
-		// Create Model Matrix to transform the model's local space to world space
-		glm::mat4 model = glm::mat4(1.0f);
-		// Create View Matrix to transform world space to view (camera) space
-		glm::mat4 view = glm::mat4(1.0f);
-		view = glm::translate(view, glm::vec3(0.0f, 0.0f, -3.0f));
-		// Create Porjection Matrixs to transform view space to clip space
-		glm::mat4 projection = glm::mat4(1.0f);
-		projection = glm::perspective(glm::radians(45.0f), (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 0.1f, 100.0f);
-		// Send the matrices to the shader
-		glUniformMatrix4fv(glGetUniformLocation(shader.id, "view"), 1, GL_FALSE, glm::value_ptr(view));
-		glUniformMatrix4fv(glGetUniformLocation(shader.id, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-
-		for (unsigned int i = 0; i < 10; i++) {
-			// Reset model identity matrix
-			model = glm::mat4(1.0f);
-			// Position cube
-			model = glm::translate(model, cubePositions[i]);
-			// Rotate cube
-			model = glm::rotate(model, (float)glfwGetTime() * glm::radians(20.0f * (i + 1)), glm::vec3(1.0f, 0.3f, 0.5f));
-			// Send model matrix to the shader
-			shader.setMat4("model", model);
-
-			glDrawArrays(GL_TRIANGLES, 0, 36);
+		{
+			PROFILE_ZONE("RenderCubes");
+			GPU_ZONE(gpuTimer, PASS_CUBES);
+
+			// TEXTURES
+			// Activate the texture unit first before binding texture (the state cache does that for us)
+			// Most graphic drivers set default texture unit to 0 and you can skip this step if you only want to assign 1 texture
+			// Bind the texture and it will automatically assign it to the fragment shader's sampler
+			glState.bindTexture(0, GL_TEXTURE_2D, texture1->id);
+			glState.bindTexture(1, GL_TEXTURE_2D, texture2->id);
+
+			glState.bindVertexArray(VAO);
+			// Activate shader programm object for the cubes
+			// Every shader and rendering call after glUseProgram will now use this program object (and thus the shaders)
+			shader.use();
+			// Setup object, lighting colors and position
+			shader.set(objectColorUniform, glm::vec3(1.0f, 0.5f, 0.31f));
+			shader.set(lightColorUniform, glm::vec3(1.0f, 1.0f, 1.0f));
+			shader.set(lightPositionUniform, lightPostion);
+
+			// Send the model matrices (model's local space to world space) and the normal matrices of all cubes.
+			// Reallocating the buffer first lets the driver hand us new memory while the GPU still reads last frame's matrices.
+			glState.bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+			glBufferData(GL_ARRAY_BUFFER, instanceModelsSize + instanceNormalsSize, NULL, GL_STREAM_DRAW);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, instanceModelsSize, &transforms.models[cubeTransforms]);
+			glBufferSubData(GL_ARRAY_BUFFER, instanceModelsSize, instanceNormalsSize, &transforms.normalMatrices[cubeTransforms]);
+
+			// Draw every cube with a single call
+			glDrawElementsInstanced(GL_TRIANGLES, objectIndexCount, GL_UNSIGNED_INT, 0, options.cubes);
+			counters.drawCalls++;
+			counters.instances += options.cubes;
 		}
 
 
 		// RENDER LIGHT SOURCE CUBE
-		glBindVertexArray(lightVAO);
+		{
+			PROFILE_ZONE("RenderLightSourceCube");
+			GPU_ZONE(gpuTimer, PASS_LIGHT_SOURCE_CUBE);
+			glState.bindVertexArray(lightVAO);
 
-		lightShader.use();
-		lightShader.setMat4("view", view);
-		lightShader.setMat4("projection", projection);
-		// Reset model identity matrix
-		model = glm::mat4(1.0f);
-		// Position the light source cube
-		model = glm::translate(model, lightPostion);
-		// Shrink the light source cube
-		model = glm::scale(model, glm::vec3(0.2f));
-		lightShader.setMat4("model", model);
+			lightShader.use();
+			lightShader.set(lightModelUniform, transforms.models[lightTransform]);
 
-		glDrawArrays(GL_TRIANGLES, 0, 36);
+			glDrawElements(GL_TRIANGLES, cubeIndexCount, GL_UNSIGNED_INT, 0);
+			counters.drawCalls++;
+			counters.instances++;
+		}
 
 
-		// RENDER TRANSPARENT GEOMETRY
-		glBindVertexArray(transparentVAO);
+		// RENDER TRANSPARENT AND SEMI-TRANSPARENT GEOMETRY
+		{
+			PROFILE_ZONE("RenderTransparentGeometry");
+			GPU_ZONE(gpuTimer, PASS_TRANSPARENT_GEOMETRY);
+			glState.bindVertexArray(transparentVAO);
+
+			glState.bindBuffer(GL_ARRAY_BUFFER, quadInstanceVBO);
+			glBufferData(GL_ARRAY_BUFFER, quadCount * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, quadCount * sizeof(glm::mat4), &transforms.models[transparentTransforms]);
+
+			blendShader.use();
+			for (const QuadBatch& batch : quadBatches) {
+				if (quadBatches.size() > 1) {
+					pointQuadInstances(batch.first);
+				}
+				glState.bindTexture(0, batch.array->target, batch.array->id);
+				glDrawArraysInstanced(GL_TRIANGLES, 0, 6, batch.count);
+				counters.drawCalls++;
+				counters.instances += batch.count;
+			}
+		}
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture3);
 
-		blendShader.use();
-		blendShader.setMat4("view", view);
-		blendShader.setMat4("projection", projection);
-		for (unsigned int i = 0; i < 5; i++) {
-			model = glm::mat4(1.0f);
-			model = glm::translate(model, transparentPositions[i]);
-			blendShader.setMat4("model", model);
-			glDrawArrays(GL_TRIANGLES, 0, 6);
+		frameUniforms.endFrame();
+
+		{
+			PROFILE_ZONE("SwapAndPoll");
+#ifndef LEARNOPENGL_NO_GLFW
+			if (window != NULL) {
+				// Swap the 2D color buffer
+				// front buffer displays the rendered image
+				// back buffer draws the next image
+				glfwSwapBuffers(window);
+				// Check if any events are triggered (e.g keyboard input or mouse movement events)
+				// updates the window state and calls the corresponding callback functions.
+				glfwPollEvents();
+			}
+#endif
+			if (options.headless) {
+				// There is no swap which would hand the frame to the driver, so flush the commands ourselves
+				glFlush();
+			}
 		}
 
+		counters.stateChanges = glState.frameIssued();
+		glState.endFrame();
+		if (options.glStats) {
+			gladInstrumentEndFrame();
+			const GLADframeStats* glFrame = gladInstrumentLastFrame();
+			counters.glCalls = glFrame->calls;
+			counters.redundantBinds = glFrame->redundantBinds;
+			counters.redundantUniforms = glFrame->redundantUniforms;
+			counters.driverTime = glFrame->driverSeconds;
+		}
+		if (benchmarking) {
+			benchmark.endFrame(counters);
+		}
+		frame++;
+	}
 
-		// RENDER SEMI-TRANSPARENT GEOMERTY
-		glBindVertexArray(semiTransparentVAO);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture4);
-		model = glm::mat4(1.0f);
-		model = glm::translate(model, semiTransparentPosition);
-		model = glm::scale(model, glm::vec3(0.5f));
-		blendShader.setMat4("model", model);
-		glDrawArrays(GL_TRIANGLES, 0, 6);
-
-
-		// Swap the 2D color buffer
-		// front buffer displays the rendered image
-		// back buffer draws the next image
-		glfwSwapBuffers(window);
-		// Check if any events are triggered (e.g keyboard input or mouse movement events)
-		// updates the window state and calls the corresponding callback functions.
-		glfwPollEvents();
+	// Wait until the GPU is done so the measured time covers all rendered frames
+	glFinish();
+	gpuTimer.flush();
+	if (options.frames > 0) {
+		double seconds = getTime() - loopStart;
+		cout << "Rendered " << frame << " frames in " << seconds << "s (" << frame / seconds << " fps)" << endl;
+	}
+	if (benchmarking) {
+		benchmark.writeReport(options.benchmarkReport, &gpuTimer);
+	}
+	if (options.glStats && frame > 0) {
+		printGLStats(frame);
+		glState.printStats();
+		cout << "Frame uniform buffer stalls: " << frameUniforms.stallCount() << " of " << frame << " frames" << endl;
+	}
+	if (options.traceFile != NULL) {
+		Profiler::instance().writeChromeTrace(options.traceFile);
 	}
 
 	// optional: deallocate all ressources once they have outlived their purpose
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
-
+	glDeleteBuffers(1, &EBO);
+	glDeleteBuffers(1, &meshVBO);
+	glDeleteBuffers(1, &meshEBO);
+	glDeleteBuffers(1, &instanceVBO);
+	glDeleteBuffers(1, &quadInstanceVBO);
+	glDeleteBuffers(1, &quadLayerVBO);
+	benchmark.destroy();
+	gpuTimer.destroy();
+	frameUniforms.destroy();
+	// the last handles, this deletes the textures
+	texture1.reset();
+	texture2.reset();
+	quadTextures.clear();
+	quadBatches.clear();
+	TextureLoader::instance().destroy();
+	shaderWatcher.stop();
+
+#ifdef LEARNOPENGL_HEADLESS
+	if (options.headless) {
+		offscreenTarget.destroy();
+		headlessContext.destroy();
+	}
+#endif
+#ifndef LEARNOPENGL_NO_GLFW
 	// clean up all the GLFW resources and properly exit the application
-	glfwTerminate();
+	if (window != NULL) {
+		glfwTerminate();
+	}
+#endif
 	return 0;
 }
-
-unsigned int loadTexture(char const* path) {
-	unsigned int textureId;
-	glGenTextures(1, &textureId);
-
-	int width, height, numberOfChannels;
-	// Load image and save it's width, height and number of channels in the corresponding variables
-	unsigned char* image = stbi_load(path, &width, &height, &numberOfChannels, 0);
-
-	if (image) {
-		GLenum format;
-
-		switch (numberOfChannels) {
-			case 1:
-				format = GL_RED;
-				break;
-			case 3:
-				format = GL_RGB;
-				break;
-			case 4:
-			default:
-				format = GL_RGBA;
-				break;
-		}
-
-		// Just like other objects we need to bind so any subsequent texture commands will configure the currently bound texture
-		glBindTexture(GL_TEXTURE_2D, textureId);
-		// Actually generate texture with the previously loaded image
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, image);
-		// Generate mipmaps
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		// Set the texture wrapping and filtering options on the currently bound texture object
-		GLint wrappingMode = format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT;
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrappingMode);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrappingMode);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	} else {
-		cout << "Texture failed to load at path: " << path << endl;
-	}
-
-	// Free the image memory
-	stbi_image_free(image);
-
-	return textureId;
-}
\ No newline at end of file
@@ -0,0 +1,150 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <atomic>
+#include <string>
+#include <sstream>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+
+// A file mapped read only into memory. The operating system pages the contents in when they are first touched,
+// so nothing is copied into a buffer of ours and several threads can read different parts at the same time.
+class MappedFile {
+public:
+	MappedFile() {}
+
+	explicit MappedFile(const string& path) {
+		open(path);
+	}
+
+	~MappedFile() {
+		close();
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool open(const string& path) {
+		close();
+#ifdef _WIN32
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE) {
+			cout << "ERROR::MAPPED_FILE::NOT_FOUND " << path << endl;
+			return false;
+		}
+		LARGE_INTEGER fileSize;
+		GetFileSizeEx(file, &fileSize);
+		length = (size_t)fileSize.QuadPart;
+		if (length > 0) {
+			mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (mapping != NULL) {
+				contents = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			}
+		}
+#else
+		descriptor = ::open(path.c_str(), O_RDONLY);
+		if (descriptor < 0) {
+			cout << "ERROR::MAPPED_FILE::NOT_FOUND " << path << endl;
+			return false;
+		}
+		struct stat status;
+		fstat(descriptor, &status);
+		length = (size_t)status.st_size;
+		if (length > 0) {
+			void* address = mmap(NULL, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+			if (address != MAP_FAILED) {
+				contents = (const unsigned char*)address;
+				// we read front to back, let the kernel read ahead
+				madvise(address, length, MADV_SEQUENTIAL);
+			}
+		}
+#endif
+		if (length > 0 && contents == NULL) {
+			cout << "ERROR::MAPPED_FILE::MAP_FAILED " << path << endl;
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void close() {
+#ifdef _WIN32
+		if (contents != NULL) {
+			UnmapViewOfFile(contents);
+		}
+		if (mapping != NULL) {
+			CloseHandle(mapping);
+		}
+		if (file != INVALID_HANDLE_VALUE) {
+			CloseHandle(file);
+		}
+		mapping = NULL;
+		file = INVALID_HANDLE_VALUE;
+#else
+		if (contents != NULL) {
+			munmap((void*)contents, length);
+		}
+		if (descriptor >= 0) {
+			::close(descriptor);
+		}
+		descriptor = -1;
+#endif
+		contents = NULL;
+		length = 0;
+	}
+
+	bool isOpen() const {
+#ifdef _WIN32
+		return file != INVALID_HANDLE_VALUE;
+#else
+		return descriptor >= 0;
+#endif
+	}
+
+	const unsigned char* data() const {
+		return contents;
+	}
+
+	size_t size() const {
+		return length;
+	}
+
+private:
+	const unsigned char* contents = NULL;
+	size_t length = 0;
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+#else
+	int descriptor = -1;
+#endif
+};
+
+// A name to write a file under before it's renamed to path. It's different for every call, also across processes,
+// so writers of the same file (jobs of the pool, or two --bake-textures runs) never write into each other's file.
+inline string uniqueTemporaryPath(const string& path) {
+	static atomic<unsigned int> counter{ 0 };
+#ifdef _WIN32
+	unsigned long process = GetCurrentProcessId();
+#else
+	unsigned long process = (unsigned long)getpid();
+#endif
+	stringstream name;
+	name << path << "." << process << "." << counter++ << ".tmp";
+	return name.str();
+}
+
+#endif
@@ -0,0 +1,261 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <filesystem>
+
+#include "profiler.h"
+#include "mapped_file.h"
+#include "mesh_loader.h"
+#include "vertex_format.h"
+
+using namespace std;
+
+// A mesh ready for glBufferData. From the cache the pointers point into the mapped file, so the data goes from the
+// page cache to the driver without being copied or parsed. When the cache can't be written they point into loaded.
+struct CachedMesh {
+	const unsigned char* vertices = NULL;
+	size_t vertexBytes = 0;
+	const unsigned int* indices = NULL;
+	size_t indexCount = 0;
+	unsigned int stride = 0;
+	glm::vec3 boundsMin = glm::vec3(0.0f);
+	glm::vec3 boundsMax = glm::vec3(0.0f);
+	// true if the mesh came from the cache, false if the source file was parsed
+	bool fromCache = false;
+
+	MappedFile file;
+	LoadedMesh loaded;
+
+	size_t vertexCount() const {
+		return stride == 0 ? 0 : vertexBytes / stride;
+	}
+
+	// Unmaps the file once the data is in the GPU buffers, the counts and bounds stay valid
+	void release() {
+		vertices = NULL;
+		indices = NULL;
+		file.close();
+		loaded = LoadedMesh();
+	}
+};
+
+// Keeps the meshes MeshLoader produced in cache/meshes, so a mesh file is only parsed the first time it is used.
+// A cache file is a fixed size header followed by the packed vertices and the indices, each blob aligned to 64 bytes:
+//
+//	Header | vertices (vertexCount * stride bytes) | indices (indexCount * 4 bytes)
+//
+// The header stores the vertex format the vertices were packed with, a version and a key built from the source
+// file's path, size and modification time. Editing the mesh, changing the format or the file layout results in a miss.
+class MeshCache {
+public:
+	static MeshCache& instance() {
+		static MeshCache cache;
+		return cache;
+	}
+
+	// Maps the cached mesh of the source file, or loads the source file and caches it on a miss
+	bool load(const string& sourcePath, const VertexFormat& format, CachedMesh& mesh) {
+		PROFILE_ZONE("LoadCachedMesh");
+		uint64_t cacheKey = key(sourcePath, format);
+		if (map(cacheKey, format, mesh)) {
+			hits++;
+			return true;
+		}
+		misses++;
+
+		if (!MeshLoader::load(sourcePath, format, mesh.loaded)) {
+			return false;
+		}
+		if (store(cacheKey, format, mesh.loaded) && map(cacheKey, format, mesh)) {
+			// the copy in the mapped file is the one that is used, free the loaded one
+			mesh.loaded = LoadedMesh();
+			mesh.fromCache = false;
+			return true;
+		}
+		mesh.vertices = mesh.loaded.vertices.data();
+		mesh.vertexBytes = mesh.loaded.vertices.size();
+		mesh.indices = mesh.loaded.indices.data();
+		mesh.indexCount = mesh.loaded.indices.size();
+		mesh.stride = mesh.loaded.stride;
+		mesh.boundsMin = mesh.loaded.boundsMin;
+		mesh.boundsMax = mesh.loaded.boundsMax;
+		mesh.fromCache = false;
+		return true;
+	}
+
+	// Identifies the cached mesh
+	uint64_t key(const string& sourcePath, const VertexFormat& format) const {
+		error_code error;
+		filesystem::path source = filesystem::absolute(sourcePath, error).lexically_normal();
+		uint64_t hash = FNV_OFFSET;
+		hash = fnv1a(hash, source.generic_string());
+		hash = fnv1a(hash, to_string(filesystem::file_size(source, error)));
+		hash = fnv1a(hash, to_string(filesystem::last_write_time(source, error).time_since_epoch().count()));
+		for (const VertexAttribute& attribute : format.attributeList()) {
+			stringstream description;
+			description << attribute.location << "," << attribute.components << "," << attribute.format << "," << attribute.offset;
+			hash = fnv1a(hash, description.str());
+		}
+		return hash;
+	}
+
+	// Where the meshes are stored, relative to the working directory
+	string directory = "cache/meshes";
+
+	unsigned int hits = 0;
+	unsigned int misses = 0;
+
+private:
+	static const uint32_t MAGIC = 0x534D474C; // "LGMS"
+	// Increase whenever the file layout or the way MeshLoader builds meshes changes
+	static const uint32_t VERSION = 1;
+	static const size_t ALIGNMENT = 64;
+	static const unsigned int MAX_ATTRIBUTES = 8;
+	static const uint64_t FNV_OFFSET = 14695981039346656037ull;
+	static const uint64_t FNV_PRIME = 1099511628211ull;
+
+	struct Header {
+		uint32_t magic = 0;
+		uint32_t version = 0;
+		uint64_t key = 0;
+		uint32_t stride = 0;
+		uint32_t attributeCount = 0;
+		// location, components, format and offset of each attribute
+		uint32_t attributes[MAX_ATTRIBUTES][4] = {};
+		uint64_t vertexCount = 0;
+		uint64_t indexCount = 0;
+		uint64_t vertexOffset = 0;
+		uint64_t indexOffset = 0;
+		float boundsMin[3] = {};
+		float boundsMax[3] = {};
+	};
+
+	static size_t align(size_t offset) {
+		return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+	}
+
+	// Fills the header fields which describe the format, false if the format doesn't fit into a header
+	static bool describe(const VertexFormat& format, Header& header) {
+		const vector<VertexAttribute>& attributes = format.attributeList();
+		if (attributes.size() > MAX_ATTRIBUTES) {
+			return false;
+		}
+		header.stride = format.stride();
+		header.attributeCount = (uint32_t)attributes.size();
+		for (size_t i = 0; i < attributes.size(); i++) {
+			header.attributes[i][0] = attributes[i].location;
+			header.attributes[i][1] = attributes[i].components;
+			header.attributes[i][2] = (uint32_t)attributes[i].format;
+			header.attributes[i][3] = attributes[i].offset;
+		}
+		return true;
+	}
+
+	bool map(uint64_t key, const VertexFormat& format, CachedMesh& mesh) {
+		string cachePath = path(key);
+		error_code error;
+		if (!filesystem::exists(cachePath, error)) {
+			return false;
+		}
+		if (!mesh.file.open(cachePath) || mesh.file.size() < sizeof(Header)) {
+			mesh.file.close();
+			return false;
+		}
+
+		Header header;
+		memcpy(&header, mesh.file.data(), sizeof(header));
+		Header expected;
+		bool valid = header.magic == MAGIC && header.version == VERSION && header.key == key && describe(format, expected)
+			&& header.stride == expected.stride && header.attributeCount == expected.attributeCount
+			&& memcmp(header.attributes, expected.attributes, sizeof(header.attributes)) == 0
+			&& header.vertexOffset % ALIGNMENT == 0 && header.indexOffset % ALIGNMENT == 0
+			&& header.vertexOffset + header.vertexCount * header.stride <= mesh.file.size()
+			&& header.indexOffset + header.indexCount * sizeof(unsigned int) <= mesh.file.size();
+		if (!valid) {
+			mesh.file.close();
+			return false;
+		}
+
+		mesh.vertices = mesh.file.data() + header.vertexOffset;
+		mesh.vertexBytes = (size_t)(header.vertexCount * header.stride);
+		mesh.indices = (const unsigned int*)(mesh.file.data() + header.indexOffset);
+		mesh.indexCount = (size_t)header.indexCount;
+		mesh.stride = header.stride;
+		mesh.boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+		mesh.boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+		mesh.fromCache = true;
+		return true;
+	}
+
+	bool store(uint64_t key, const VertexFormat& format, const LoadedMesh& mesh) {
+		PROFILE_ZONE("StoreCachedMesh");
+		Header header;
+		if (!describe(format, header)) {
+			return false;
+		}
+		header.magic = MAGIC;
+		header.version = VERSION;
+		header.key = key;
+		header.vertexCount = mesh.vertexCount();
+		header.indexCount = mesh.indices.size();
+		header.vertexOffset = align(sizeof(Header));
+		header.indexOffset = align(header.vertexOffset + mesh.vertices.size());
+		memcpy(header.boundsMin, &mesh.boundsMin[0], sizeof(header.boundsMin));
+		memcpy(header.boundsMax, &mesh.boundsMax[0], sizeof(header.boundsMax));
+
+		error_code error;
+		filesystem::create_directories(directory, error);
+		// write under a name of our own and rename, so a half written file is never mistaken for a complete one
+		string cachePath = path(key);
+		string temporaryPath = uniqueTemporaryPath(cachePath);
+		{
+			ofstream file(temporaryPath, ios::binary | ios::trunc);
+			if (!file) {
+				cout << "ERROR::MESH_CACHE::NOT_WRITABLE " << temporaryPath << endl;
+				return false;
+			}
+			const char padding[ALIGNMENT] = {};
+			file.write((const char*)&header, sizeof(header));
+			file.write(padding, header.vertexOffset - sizeof(header));
+			file.write((const char*)mesh.vertices.data(), mesh.vertices.size());
+			file.write(padding, header.indexOffset - header.vertexOffset - mesh.vertices.size());
+			file.write((const char*)mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+			if (!file) {
+				cout << "ERROR::MESH_CACHE::WRITE_FAILED " << temporaryPath << endl;
+				return false;
+			}
+		}
+		filesystem::rename(temporaryPath, cachePath, error);
+		if (error) {
+			cout << "ERROR::MESH_CACHE::NOT_WRITABLE " << cachePath << endl;
+			filesystem::remove(temporaryPath, error);
+			return false;
+		}
+		return true;
+	}
+
+	static uint64_t fnv1a(uint64_t hash, const string& text) {
+		for (unsigned char c : text) {
+			hash = (hash ^ c) * FNV_PRIME;
+		}
+		// Separate the strings so "ab" + "c" and "a" + "bc" don't collide
+		return (hash ^ 0xFF) * FNV_PRIME;
+	}
+
+	string path(uint64_t key) const {
+		stringstream name;
+		name << directory << "/" << hex << key << ".mesh";
+		return name.str();
+	}
+};
+
+#endif
@@ -0,0 +1,903 @@
+#ifndef MESH_LOADER_H
+#define MESH_LOADER_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <mutex>
+#include <atomic>
+#include <cctype>
+#include <cfloat>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#include "profiler.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+#include "vertex_format.h"
+#include "mesh_optimizer.h"
+
+using namespace std;
+
+// A mesh read from a file, ready to be copied into a vertex and an element buffer
+struct LoadedMesh {
+	// packed with the VertexFormat given to the loader
+	vector<unsigned char> vertices;
+	vector<unsigned int> indices;
+	// bytes per vertex
+	unsigned int stride = 0;
+	// axis aligned bounding box of the positions
+	glm::vec3 boundsMin = glm::vec3(0.0f);
+	glm::vec3 boundsMax = glm::vec3(0.0f);
+
+	size_t vertexCount() const {
+		return stride == 0 ? 0 : vertices.size() / stride;
+	}
+};
+
+// Just enough JSON for the scene description of a glTF file
+struct JsonValue {
+	enum Type { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+	Type type = JSON_NULL;
+	double number = 0.0;
+	string text;
+	// array elements, or the values of an object's members
+	vector<JsonValue> items;
+	// names of an object's members, in the same order as items
+	vector<string> keys;
+
+	const JsonValue* find(const string& key) const {
+		for (size_t i = 0; i < keys.size(); i++) {
+			if (keys[i] == key) {
+				return &items[i];
+			}
+		}
+		return NULL;
+	}
+
+	double numberOr(const string& key, double fallback) const {
+		const JsonValue* member = find(key);
+		return member != NULL && member->type == JSON_NUMBER ? member->number : fallback;
+	}
+
+	// Parses [c, end), returns false on a syntax error
+	static bool parse(const char*& c, const char* end, JsonValue& value) {
+		skipSpaces(c, end);
+		if (c >= end) {
+			return false;
+		}
+		if (*c == '{') {
+			value.type = JSON_OBJECT;
+			c++;
+			skipSpaces(c, end);
+			if (c < end && *c == '}') {
+				c++;
+				return true;
+			}
+			while (c < end) {
+				JsonValue key;
+				skipSpaces(c, end);
+				if (!parse(c, end, key) || key.type != JSON_STRING) {
+					return false;
+				}
+				skipSpaces(c, end);
+				if (c >= end || *c++ != ':') {
+					return false;
+				}
+				value.keys.push_back(key.text);
+				value.items.push_back(JsonValue());
+				if (!parse(c, end, value.items.back())) {
+					return false;
+				}
+				skipSpaces(c, end);
+				if (c < end && *c == ',') {
+					c++;
+				} else {
+					return c < end && *c++ == '}';
+				}
+			}
+			return false;
+		}
+		if (*c == '[') {
+			value.type = JSON_ARRAY;
+			c++;
+			skipSpaces(c, end);
+			if (c < end && *c == ']') {
+				c++;
+				return true;
+			}
+			while (c < end) {
+				value.items.push_back(JsonValue());
+				if (!parse(c, end, value.items.back())) {
+					return false;
+				}
+				skipSpaces(c, end);
+				if (c < end && *c == ',') {
+					c++;
+				} else {
+					return c < end && *c++ == ']';
+				}
+			}
+			return false;
+		}
+		if (*c == '"') {
+			value.type = JSON_STRING;
+			for (c++; c < end && *c != '"'; c++) {
+				if (*c == '\\' && c + 1 < end) {
+					// the names glTF uses are plain ASCII, other escapes are kept as they are
+					c++;
+					value.text += *c == 'n' ? '\n' : *c == 't' ? '\t' : *c;
+				} else {
+					value.text += *c;
+				}
+			}
+			return c++ < end;
+		}
+		if (end - c >= 4 && strncmp(c, "true", 4) == 0) {
+			value.type = JSON_BOOL;
+			value.number = 1.0;
+			c += 4;
+			return true;
+		}
+		if (end - c >= 5 && strncmp(c, "false", 5) == 0) {
+			value.type = JSON_BOOL;
+			c += 5;
+			return true;
+		}
+		if (end - c >= 4 && strncmp(c, "null", 4) == 0) {
+			c += 4;
+			return true;
+		}
+		// strtod needs a terminated string, numbers are short
+		char number[64];
+		size_t length = 0;
+		while (c + length < end && length < sizeof(number) - 1 && strchr("+-.0123456789eE", c[length]) != NULL) {
+			length++;
+		}
+		if (length == 0) {
+			return false;
+		}
+		memcpy(number, c, length);
+		number[length] = '\0';
+		value.type = JSON_NUMBER;
+		value.number = strtod(number, NULL);
+		c += length;
+		return true;
+	}
+
+private:
+	static void skipSpaces(const char*& c, const char* end) {
+		while (c < end && (*c == ' ' || *c == '\t' || *c == '\n' || *c == '\r')) {
+			c++;
+		}
+	}
+};
+
+// Loads Wavefront OBJ and binary glTF (.glb) meshes.
+// The file is memory mapped and the work is split across the shared thread pool: OBJ text is cut into chunks at
+// line breaks which are parsed at the same time, glTF vertices are converted in ranges. The vertices are packed
+// straight into the given VertexFormat, whose attributes have to be the position (3 floats), the texture
+// coordinates (2) and the normal (3) in this order, like CubeLayout and MeshLayout in main.cpp.
+// Missing texture coordinates are 0, missing normals are the area weighted average of the adjacent faces.
+// Finally the triangles are ordered for the vertex cache and the vertices for fetching (see MeshOptimizer).
+namespace MeshLoader {
+	// Floats of a vertex before it is packed: position, texture coordinates, normal
+	const unsigned int SOURCE_STRIDE = 8;
+
+	// A corner of an OBJ face without texture coordinates or normal
+	const int32_t NO_INDEX = INT32_MIN;
+	// OBJ indices start at 1, negative ones count back from the last element defined so far. The chunks are parsed
+	// before it is known how many elements the chunks in front of them define, so negative indices are stored relative
+	// to the start of their chunk and moved below zero by this bias. Positive ones are stored 0 based.
+	const int32_t RELATIVE_BIAS = 1 << 30;
+
+	// The part of an OBJ file one job parses
+	struct ObjChunk {
+		const char* begin = NULL;
+		const char* end = NULL;
+		vector<float> positions;
+		vector<float> texCoords;
+		vector<float> normals;
+		// position, texture coordinates and normal index of every triangle corner, polygons are split into fans
+		vector<int32_t> corners;
+		glm::vec3 boundsMin = glm::vec3(FLT_MAX);
+		glm::vec3 boundsMax = glm::vec3(-FLT_MAX);
+		bool error = false;
+		// elements defined by the chunks before this one
+		size_t positionStart = 0, texCoordStart = 0, normalStart = 0;
+	};
+
+	inline const char* skipSpaces(const char* c, const char* end) {
+		while (c < end && (*c == ' ' || *c == '\t')) {
+			c++;
+		}
+		return c;
+	}
+
+	inline const char* skipLine(const char* c, const char* end) {
+		while (c < end && *c != '\n') {
+			c++;
+		}
+		return c < end ? c + 1 : end;
+	}
+
+	// Much faster than strtof since it neither needs a terminated string nor looks at the locale.
+	// Digits beyond what a double holds exactly may round differently, far below float precision.
+	inline const char* parseFloat(const char* c, const char* end, float& value, bool& valid) {
+		static const double POWERS_OF_TEN[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+		c = skipSpaces(c, end);
+		bool negative = false;
+		if (c < end && (*c == '-' || *c == '+')) {
+			negative = *c == '-';
+			c++;
+		}
+		const char* digitsStart = c;
+		double mantissa = 0.0;
+		int exponent = 0;
+		while (c < end && *c >= '0' && *c <= '9') {
+			mantissa = mantissa * 10.0 + (*c++ - '0');
+		}
+		if (c < end && *c == '.') {
+			c++;
+			while (c < end && *c >= '0' && *c <= '9') {
+				mantissa = mantissa * 10.0 + (*c++ - '0');
+				exponent--;
+			}
+		}
+		if (c == digitsStart) {
+			valid = false;
+			return c;
+		}
+		if (c < end && (*c == 'e' || *c == 'E')) {
+			c++;
+			bool negativeExponent = false;
+			if (c < end && (*c == '-' || *c == '+')) {
+				negativeExponent = *c == '-';
+				c++;
+			}
+			int power = 0;
+			while (c < end && *c >= '0' && *c <= '9') {
+				power = power * 10 + (*c++ - '0');
+			}
+			exponent += negativeExponent ? -power : power;
+		}
+		if (exponent != 0) {
+			int magnitude = exponent < 0 ? -exponent : exponent;
+			double scale = magnitude <= 18 ? POWERS_OF_TEN[magnitude] : pow(10.0, magnitude);
+			mantissa = exponent < 0 ? mantissa / scale : mantissa * scale;
+		}
+		value = (float)(negative ? -mantissa : mantissa);
+		return c;
+	}
+
+	// Reads one corner of a face ("v", "v/vt", "v//vn" or "v/vt/vn") and stores its three indices
+	inline const char* parseCorner(const char* c, const char* end, const ObjChunk& chunk, int32_t* corner, bool& valid) {
+		size_t counts[3] = { chunk.positions.size() / 3, chunk.texCoords.size() / 2, chunk.normals.size() / 3 };
+		for (int element = 0; element < 3; element++) {
+			corner[element] = NO_INDEX;
+			if (element > 0) {
+				if (c >= end || *c != '/') {
+					continue;
+				}
+				c++;
+			}
+			bool negative = c < end && *c == '-';
+			if (negative) {
+				c++;
+			}
+			long long index = 0;
+			const char* digitsStart = c;
+			while (c < end && *c >= '0' && *c <= '9') {
+				index = index * 10 + (*c++ - '0');
+			}
+			if (c == digitsStart) {
+				// "v//vn" leaves out the texture coordinates, the position can't be left out
+				if (element == 0 || negative) {
+					valid = false;
+				}
+				continue;
+			}
+			if (index == 0) {
+				valid = false;
+			} else if (negative) {
+				corner[element] = (int32_t)((long long)counts[element] - index - RELATIVE_BIAS);
+			} else {
+				corner[element] = (int32_t)(index - 1);
+			}
+		}
+		return c;
+	}
+
+	inline void parseObjChunk(ObjChunk& chunk) {
+		PROFILE_ZONE("ParseObjChunk");
+		vector<int32_t> polygon;
+		const char* end = chunk.end;
+		for (const char* c = chunk.begin; c < end; c = skipLine(c, end)) {
+			c = skipSpaces(c, end);
+			if (end - c < 2 || (c[1] != ' ' && c[1] != '\t' && c[1] != 't' && c[1] != 'n')) {
+				continue;
+			}
+			bool valid = true;
+			if (c[0] == 'v' && (c[1] == ' ' || c[1] == '\t')) {
+				float position[3];
+				c++;
+				for (int i = 0; i < 3; i++) {
+					c = parseFloat(c, end, position[i], valid);
+				}
+				chunk.positions.insert(chunk.positions.end(), position, position + 3);
+				chunk.boundsMin = glm::min(chunk.boundsMin, glm::vec3(position[0], position[1], position[2]));
+				chunk.boundsMax = glm::max(chunk.boundsMax, glm::vec3(position[0], position[1], position[2]));
+			} else if (c[0] == 'v' && c[1] == 't') {
+				float texCoords[2];
+				c += 2;
+				c = parseFloat(c, end, texCoords[0], valid);
+				// a missing v means 0, a third coordinate is ignored
+				bool hasV = true;
+				parseFloat(c, end, texCoords[1], hasV);
+				if (!hasV) {
+					texCoords[1] = 0.0f;
+				}
+				chunk.texCoords.insert(chunk.texCoords.end(), texCoords, texCoords + 2);
+			} else if (c[0] == 'v' && c[1] == 'n') {
+				float normal[3];
+				c += 2;
+				for (int i = 0; i < 3; i++) {
+					c = parseFloat(c, end, normal[i], valid);
+				}
+				chunk.normals.insert(chunk.normals.end(), normal, normal + 3);
+			} else if (c[0] == 'f' && (c[1] == ' ' || c[1] == '\t')) {
+				polygon.clear();
+				c = skipSpaces(c + 1, end);
+				while (c < end && *c != '\n' && *c != '\r' && *c != '#') {
+					int32_t corner[3];
+					c = skipSpaces(parseCorner(c, end, chunk, corner, valid), end);
+					if (!valid) {
+						break;
+					}
+					polygon.insert(polygon.end(), corner, corner + 3);
+				}
+				size_t cornerCount = polygon.size() / 3;
+				for (size_t i = 1; valid && i + 1 < cornerCount; i++) {
+					chunk.corners.insert(chunk.corners.end(), polygon.begin(), polygon.begin() + 3);
+					chunk.corners.insert(chunk.corners.end(), polygon.begin() + i * 3, polygon.begin() + i * 3 + 6);
+				}
+			} else {
+				continue;
+			}
+			if (!valid) {
+				chunk.error = true;
+				return;
+			}
+		}
+	}
+
+	// Turns the stored index into an absolute one, false if it is out of range
+	inline bool resolveIndex(int32_t& index, size_t chunkStart, size_t count) {
+		if (index == NO_INDEX) {
+			return true;
+		}
+		long long absolute = index >= 0 ? index : (long long)index + RELATIVE_BIAS + (long long)chunkStart;
+		if (absolute < 0 || absolute >= (long long)count) {
+			return false;
+		}
+		index = (int32_t)absolute;
+		return true;
+	}
+
+	// Adds the area weighted face normal of every triangle to its corners, the caller normalizes the sums
+	inline void accumulateNormals(const vector<unsigned int>& indices, const float* positions, unsigned int positionStride, vector<glm::vec3>& normals) {
+		for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+			const float* a = positions + (size_t)indices[i] * positionStride;
+			const float* b = positions + (size_t)indices[i + 1] * positionStride;
+			const float* c = positions + (size_t)indices[i + 2] * positionStride;
+			glm::vec3 edge1(b[0] - a[0], b[1] - a[1], b[2] - a[2]);
+			glm::vec3 edge2(c[0] - a[0], c[1] - a[1], c[2] - a[2]);
+			glm::vec3 faceNormal = glm::cross(edge1, edge2);
+			for (int corner = 0; corner < 3; corner++) {
+				normals[indices[i + corner]] += faceNormal;
+			}
+		}
+	}
+
+	inline glm::vec3 normalizeOrUp(const glm::vec3& normal) {
+		float length = glm::length(normal);
+		return length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+	}
+
+	inline bool loadObj(const MappedFile& file, const VertexFormat& format, LoadedMesh& mesh, ThreadPool& pool) {
+		const char* text = (const char*)file.data();
+		const char* end = text + file.size();
+
+		// cut the file into chunks at line breaks, a few per thread so uneven chunks even out
+		size_t chunkCount = max<size_t>(1, min<size_t>(pool.size() * 4, file.size() / (256 * 1024)));
+		vector<ObjChunk> chunks(chunkCount);
+		const char* chunkBegin = text;
+		for (size_t i = 0; i < chunkCount; i++) {
+			const char* chunkEnd = i + 1 == chunkCount ? end : text + file.size() * (i + 1) / chunkCount;
+			chunkEnd = max(chunkEnd, chunkBegin);
+			if (chunkEnd < end) {
+				chunkEnd = skipLine(chunkEnd, end);
+			}
+			chunks[i].begin = chunkBegin;
+			chunks[i].end = chunkEnd;
+			chunkBegin = chunkEnd;
+		}
+		pool.parallelFor(chunkCount, [&chunks](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				parseObjChunk(chunks[i]);
+			}
+		});
+
+		size_t positionCount = 0, texCoordCount = 0, normalCount = 0, cornerCount = 0;
+		mesh.boundsMin = glm::vec3(FLT_MAX);
+		mesh.boundsMax = glm::vec3(-FLT_MAX);
+		for (ObjChunk& chunk : chunks) {
+			if (chunk.error) {
+				cout << "ERROR::MESH_LOADER::OBJ_SYNTAX_ERROR" << endl;
+				return false;
+			}
+			chunk.positionStart = positionCount;
+			chunk.texCoordStart = texCoordCount;
+			chunk.normalStart = normalCount;
+			positionCount += chunk.positions.size() / 3;
+			texCoordCount += chunk.texCoords.size() / 2;
+			normalCount += chunk.normals.size() / 3;
+			cornerCount += chunk.corners.size() / 3;
+			mesh.boundsMin = glm::min(mesh.boundsMin, chunk.boundsMin);
+			mesh.boundsMax = glm::max(mesh.boundsMax, chunk.boundsMax);
+		}
+		if (positionCount == 0 || cornerCount == 0) {
+			cout << "ERROR::MESH_LOADER::OBJ_HAS_NO_FACES" << endl;
+			return false;
+		}
+
+		pool.parallelFor(chunkCount, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				ObjChunk& chunk = chunks[i];
+				for (size_t c = 0; c < chunk.corners.size() && !chunk.error; c += 3) {
+					chunk.error = !resolveIndex(chunk.corners[c], chunk.positionStart, positionCount)
+						|| !resolveIndex(chunk.corners[c + 1], chunk.texCoordStart, texCoordCount)
+						|| !resolveIndex(chunk.corners[c + 2], chunk.normalStart, normalCount);
+				}
+			}
+		});
+
+		// One vertex per distinct combination of position, texture coordinates and normal, found with an open
+		// addressing hash table which is grown whenever it gets half full. This is the only sequential part.
+		vector<int32_t> vertexKeys;
+		mesh.indices.resize(cornerCount);
+		{
+			PROFILE_ZONE("WeldObjVertices");
+			const uint32_t EMPTY = 0xFFFFFFFF;
+			size_t tableSize = 1024;
+			while (tableSize < positionCount * 2) {
+				tableSize <<= 1;
+			}
+			vector<uint32_t> table(tableSize, EMPTY);
+			auto hashKey = [](const int32_t* key) {
+				uint32_t hash = (uint32_t)key[0] * 73856093u ^ (uint32_t)key[1] * 19349663u ^ (uint32_t)key[2] * 83492791u;
+				return hash ^ (hash >> 15);
+			};
+			size_t corner = 0;
+			for (const ObjChunk& chunk : chunks) {
+				if (chunk.error) {
+					cout << "ERROR::MESH_LOADER::OBJ_INDEX_OUT_OF_RANGE" << endl;
+					return false;
+				}
+				for (size_t c = 0; c < chunk.corners.size(); c += 3) {
+					const int32_t* key = &chunk.corners[c];
+					size_t slot = hashKey(key) & (tableSize - 1);
+					while (table[slot] != EMPTY && memcmp(&vertexKeys[(size_t)table[slot] * 3], key, 3 * sizeof(int32_t)) != 0) {
+						slot = (slot + 1) & (tableSize - 1);
+					}
+					uint32_t vertex = table[slot];
+					if (vertex == EMPTY) {
+						vertex = (uint32_t)(vertexKeys.size() / 3);
+						table[slot] = vertex;
+						vertexKeys.insert(vertexKeys.end(), key, key + 3);
+						if (vertexKeys.size() / 3 * 2 > tableSize) {
+							tableSize <<= 1;
+							table.assign(tableSize, EMPTY);
+							for (uint32_t v = 0; v < vertexKeys.size() / 3; v++) {
+								size_t rehashed = hashKey(&vertexKeys[(size_t)v * 3]) & (tableSize - 1);
+								while (table[rehashed] != EMPTY) {
+									rehashed = (rehashed + 1) & (tableSize - 1);
+								}
+								table[rehashed] = v;
+							}
+						}
+					}
+					mesh.indices[corner++] = vertex;
+				}
+			}
+		}
+		size_t vertexCount = vertexKeys.size() / 3;
+
+		// gather the elements of all chunks so the vertices can look them up by absolute index
+		auto gather = [&chunks](vector<float> ObjChunk::* elements) {
+			vector<const float*> starts;
+			for (const ObjChunk& chunk : chunks) {
+				starts.push_back((chunk.*elements).data());
+			}
+			return starts;
+		};
+		vector<const float*> positionChunks = gather(&ObjChunk::positions);
+		vector<const float*> texCoordChunks = gather(&ObjChunk::texCoords);
+		vector<const float*> normalChunks = gather(&ObjChunk::normals);
+		vector<size_t> positionStarts, texCoordStarts, normalStarts;
+		for (const ObjChunk& chunk : chunks) {
+			positionStarts.push_back(chunk.positionStart);
+			texCoordStarts.push_back(chunk.texCoordStart);
+			normalStarts.push_back(chunk.normalStart);
+		}
+		auto element = [](const vector<const float*>& data, const vector<size_t>& starts, int32_t index, unsigned int components) {
+			// the last chunk starting at or before the index, chunks which define none of these elements are skipped that way
+			size_t chunk = upper_bound(starts.begin(), starts.end(), (size_t)index) - starts.begin() - 1;
+			return data[chunk] + ((size_t)index - starts[chunk]) * components;
+		};
+
+		vector<float> vertexPositions(vertexCount * 3);
+		bool missingNormals = false;
+		for (size_t v = 0; v < vertexCount && !missingNormals; v++) {
+			missingNormals = vertexKeys[v * 3 + 2] == NO_INDEX;
+		}
+		pool.parallelFor(vertexCount, [&](size_t begin, size_t end) {
+			for (size_t v = begin; v < end; v++) {
+				memcpy(&vertexPositions[v * 3], element(positionChunks, positionStarts, vertexKeys[v * 3], 3), 3 * sizeof(float));
+			}
+		}, 4096);
+
+		// Faces without normals get the average of the faces around each position
+		vector<glm::vec3> generatedNormals;
+		if (missingNormals) {
+			PROFILE_ZONE("GenerateNormals");
+			vector<unsigned int> positionIndices(mesh.indices.size());
+			for (size_t i = 0; i < mesh.indices.size(); i++) {
+				positionIndices[i] = (unsigned int)vertexKeys[(size_t)mesh.indices[i] * 3];
+			}
+			vector<float> allPositions;
+			allPositions.reserve(positionCount * 3);
+			for (const ObjChunk& chunk : chunks) {
+				allPositions.insert(allPositions.end(), chunk.positions.begin(), chunk.positions.end());
+			}
+			generatedNormals.assign(positionCount, glm::vec3(0.0f));
+			accumulateNormals(positionIndices, allPositions.data(), 3, generatedNormals);
+		}
+
+		mesh.stride = format.stride();
+		mesh.vertices.resize(vertexCount * mesh.stride);
+		pool.parallelFor(vertexCount, [&](size_t begin, size_t end) {
+			PROFILE_ZONE("PackObjVertices");
+			float source[SOURCE_STRIDE] = {};
+			for (size_t v = begin; v < end; v++) {
+				const int32_t* key = &vertexKeys[v * 3];
+				memcpy(source, &vertexPositions[v * 3], 3 * sizeof(float));
+				if (key[1] != NO_INDEX) {
+					memcpy(source + 3, element(texCoordChunks, texCoordStarts, key[1], 2), 2 * sizeof(float));
+				} else {
+					source[3] = source[4] = 0.0f;
+				}
+				glm::vec3 normal;
+				if (key[2] != NO_INDEX) {
+					const float* n = element(normalChunks, normalStarts, key[2], 3);
+					normal = glm::vec3(n[0], n[1], n[2]);
+				} else {
+					normal = generatedNormals[key[0]];
+				}
+				normal = normalizeOrUp(normal);
+				memcpy(source + 5, &normal[0], 3 * sizeof(float));
+				format.packVertex(source, &mesh.vertices[v * mesh.stride]);
+			}
+		}, 4096);
+		return true;
+	}
+
+	// A glTF accessor resolved to a pointer into the binary chunk
+	struct GltfAccessor {
+		const unsigned char* data = NULL;
+		size_t count = 0;
+		size_t stride = 0;
+		int componentType = 0;
+		unsigned int components = 0;
+		bool normalized = false;
+
+		// Reads a component as float, normalized integers are mapped to [0, 1]
+		float read(size_t element, unsigned int component) const {
+			const unsigned char* value = data + element * stride;
+			switch (componentType) {
+				case 5126: {
+					float result;
+					memcpy(&result, value + component * 4, 4);
+					return result;
+				}
+				case 5121:
+					return normalized ? value[component] / 255.0f : (float)value[component];
+				case 5123: {
+					uint16_t result;
+					memcpy(&result, value + component * 2, 2);
+					return normalized ? result / 65535.0f : (float)result;
+				}
+			}
+			return 0.0f;
+		}
+
+		unsigned int readIndex(size_t element) const {
+			const unsigned char* value = data + element * stride;
+			if (componentType == 5121) {
+				return value[0];
+			}
+			if (componentType == 5123) {
+				uint16_t result;
+				memcpy(&result, value, 2);
+				return result;
+			}
+			uint32_t result;
+			memcpy(&result, value, 4);
+			return result;
+		}
+	};
+
+	inline bool resolveAccessor(const JsonValue& json, const unsigned char* binary, size_t binarySize, double index, GltfAccessor& accessor) {
+		const JsonValue* accessors = json.find("accessors");
+		const JsonValue* bufferViews = json.find("bufferViews");
+		if (accessors == NULL || bufferViews == NULL || index < 0 || index >= accessors->items.size()) {
+			return false;
+		}
+		const JsonValue& description = accessors->items[(size_t)index];
+		double viewIndex = description.numberOr("bufferView", -1.0);
+		if (viewIndex < 0 || viewIndex >= bufferViews->items.size()) {
+			// accessors without a buffer view are all zeros (or sparse), which we don't support
+			return false;
+		}
+		const JsonValue& view = bufferViews->items[(size_t)viewIndex];
+		if (view.numberOr("buffer", 0.0) != 0.0) {
+			return false;
+		}
+
+		const JsonValue* type = description.find("type");
+		string typeName = type != NULL ? type->text : "";
+		accessor.components = typeName == "SCALAR" ? 1 : typeName == "VEC2" ? 2 : typeName == "VEC3" ? 3 : typeName == "VEC4" ? 4 : 0;
+		accessor.componentType = (int)description.numberOr("componentType", 0.0);
+		unsigned int componentSize = accessor.componentType == 5126 || accessor.componentType == 5125 ? 4
+			: accessor.componentType == 5123 || accessor.componentType == 5122 ? 2 : 1;
+		const JsonValue* normalized = description.find("normalized");
+		accessor.normalized = normalized != NULL && normalized->number != 0.0;
+		accessor.count = (size_t)description.numberOr("count", 0.0);
+		accessor.stride = (size_t)view.numberOr("byteStride", 0.0);
+		if (accessor.stride == 0) {
+			accessor.stride = accessor.components * componentSize;
+		}
+
+		size_t viewOffset = (size_t)view.numberOr("byteOffset", 0.0);
+		size_t viewLength = (size_t)view.numberOr("byteLength", 0.0);
+		size_t offset = (size_t)description.numberOr("byteOffset", 0.0);
+		size_t lastByte = accessor.count == 0 ? 0 : offset + (accessor.count - 1) * accessor.stride + accessor.components * componentSize;
+		if (accessor.components == 0 || viewOffset + viewLength > binarySize || lastByte > viewLength) {
+			return false;
+		}
+		accessor.data = binary + viewOffset + offset;
+		return true;
+	}
+
+	inline bool loadGlb(const MappedFile& file, const VertexFormat& format, LoadedMesh& mesh, ThreadPool& pool) {
+		// 12 byte header: magic "glTF", version, length. Then chunks of length, type and data: JSON first, BIN second.
+		const unsigned char* data = file.data();
+		uint32_t header[3];
+		if (file.size() < 20) {
+			cout << "ERROR::MESH_LOADER::GLB_TRUNCATED" << endl;
+			return false;
+		}
+		memcpy(header, data, sizeof(header));
+		if (header[0] != 0x46546C67 || header[1] != 2) {
+			cout << "ERROR::MESH_LOADER::NOT_A_GLTF_2_BINARY" << endl;
+			return false;
+		}
+		const unsigned char* jsonChunk = NULL;
+		const unsigned char* binary = NULL;
+		size_t jsonSize = 0, binarySize = 0;
+		for (size_t offset = 12; offset + 8 <= file.size();) {
+			uint32_t chunk[2];
+			memcpy(chunk, data + offset, sizeof(chunk));
+			if (offset + 8 + chunk[0] > file.size()) {
+				cout << "ERROR::MESH_LOADER::GLB_TRUNCATED" << endl;
+				return false;
+			}
+			if (chunk[1] == 0x4E4F534A && jsonChunk == NULL) {
+				jsonChunk = data + offset + 8;
+				jsonSize = chunk[0];
+			} else if (chunk[1] == 0x004E4942 && binary == NULL) {
+				binary = data + offset + 8;
+				binarySize = chunk[0];
+			}
+			offset += 8 + chunk[0];
+		}
+
+		JsonValue json;
+		const char* cursor = (const char*)jsonChunk;
+		if (jsonChunk == NULL || binary == NULL || !JsonValue::parse(cursor, cursor + jsonSize, json)) {
+			cout << "ERROR::MESH_LOADER::GLB_INVALID_CHUNKS" << endl;
+			return false;
+		}
+
+		// Every triangle primitive of every mesh, in the space of its mesh (node transforms are not applied)
+		struct Primitive {
+			GltfAccessor positions, texCoords, normals, indices;
+			bool hasTexCoords = false, hasNormals = false, hasIndices = false;
+			size_t firstVertex = 0, firstIndex = 0;
+		};
+		vector<Primitive> primitives;
+		size_t vertexCount = 0, indexCount = 0;
+		const JsonValue* meshes = json.find("meshes");
+		for (size_t m = 0; meshes != NULL && m < meshes->items.size(); m++) {
+			const JsonValue* meshPrimitives = meshes->items[m].find("primitives");
+			for (size_t p = 0; meshPrimitives != NULL && p < meshPrimitives->items.size(); p++) {
+				const JsonValue& description = meshPrimitives->items[p];
+				const JsonValue* attributes = description.find("attributes");
+				if (description.numberOr("mode", 4.0) != 4.0 || attributes == NULL) {
+					cout << "ERROR::MESH_LOADER::GLB_SKIPPED_NON_TRIANGLE_PRIMITIVE" << endl;
+					continue;
+				}
+				Primitive primitive;
+				if (!resolveAccessor(json, binary, binarySize, attributes->numberOr("POSITION", -1.0), primitive.positions)
+					|| primitive.positions.componentType != 5126 || primitive.positions.components != 3) {
+					cout << "ERROR::MESH_LOADER::GLB_INVALID_POSITIONS" << endl;
+					return false;
+				}
+				primitive.hasNormals = attributes->find("NORMAL") != NULL;
+				primitive.hasTexCoords = attributes->find("TEXCOORD_0") != NULL;
+				primitive.hasIndices = description.find("indices") != NULL;
+				// Normals are float vectors, texture coordinates float or normalized 8 or 16 bit and indices unsigned integers.
+				// Other component counts would be read past the range resolveAccessor checked, other types would read as 0.
+				const GltfAccessor& normals = primitive.normals;
+				const GltfAccessor& texCoords = primitive.texCoords;
+				const GltfAccessor& indices = primitive.indices;
+				bool validNormals = !primitive.hasNormals || (resolveAccessor(json, binary, binarySize, attributes->numberOr("NORMAL", -1.0), primitive.normals)
+					&& normals.count == primitive.positions.count && normals.componentType == 5126 && normals.components == 3);
+				bool validTexCoords = !primitive.hasTexCoords || (resolveAccessor(json, binary, binarySize, attributes->numberOr("TEXCOORD_0", -1.0), primitive.texCoords)
+					&& texCoords.count == primitive.positions.count && texCoords.components == 2
+					&& (texCoords.componentType == 5126 || ((texCoords.componentType == 5121 || texCoords.componentType == 5123) && texCoords.normalized)));
+				bool validIndices = !primitive.hasIndices || (resolveAccessor(json, binary, binarySize, description.numberOr("indices", -1.0), primitive.indices)
+					&& indices.components == 1 && (indices.componentType == 5121 || indices.componentType == 5123 || indices.componentType == 5125));
+				if (!validNormals || !validTexCoords || !validIndices) {
+					cout << "ERROR::MESH_LOADER::GLB_INVALID_ACCESSOR" << endl;
+					return false;
+				}
+				primitive.firstVertex = vertexCount;
+				primitive.firstIndex = indexCount;
+				vertexCount += primitive.positions.count;
+				indexCount += primitive.hasIndices ? primitive.indices.count : primitive.positions.count;
+				primitives.push_back(primitive);
+			}
+		}
+		if (vertexCount == 0 || indexCount == 0) {
+			cout << "ERROR::MESH_LOADER::GLB_HAS_NO_TRIANGLES" << endl;
+			return false;
+		}
+
+		mesh.indices.resize(indexCount);
+		for (const Primitive& primitive : primitives) {
+			size_t count = primitive.hasIndices ? primitive.indices.count : primitive.positions.count;
+			atomic<bool> outOfRange{ false };
+			pool.parallelFor(count, [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; i++) {
+					unsigned int index = primitive.hasIndices ? primitive.indices.readIndex(i) : (unsigned int)i;
+					if (index >= primitive.positions.count) {
+						outOfRange = true;
+						index = 0;
+					}
+					mesh.indices[primitive.firstIndex + i] = (unsigned int)primitive.firstVertex + index;
+				}
+			}, 16384);
+			if (outOfRange) {
+				cout << "ERROR::MESH_LOADER::GLB_INDEX_OUT_OF_RANGE" << endl;
+				return false;
+			}
+		}
+
+		mesh.stride = format.stride();
+		mesh.vertices.resize(vertexCount * mesh.stride);
+		mesh.boundsMin = glm::vec3(FLT_MAX);
+		mesh.boundsMax = glm::vec3(-FLT_MAX);
+		mutex boundsMutex;
+		for (const Primitive& primitive : primitives) {
+			vector<glm::vec3> generatedNormals;
+			if (!primitive.hasNormals) {
+				vector<float> positions(primitive.positions.count * 3);
+				for (size_t v = 0; v < primitive.positions.count; v++) {
+					for (unsigned int c = 0; c < 3; c++) {
+						positions[v * 3 + c] = primitive.positions.read(v, c);
+					}
+				}
+				size_t count = primitive.hasIndices ? primitive.indices.count : primitive.positions.count;
+				vector<unsigned int> indices(mesh.indices.begin() + primitive.firstIndex, mesh.indices.begin() + primitive.firstIndex + count);
+				for (unsigned int& index : indices) {
+					index -= (unsigned int)primitive.firstVertex;
+				}
+				generatedNormals.assign(primitive.positions.count, glm::vec3(0.0f));
+				accumulateNormals(indices, positions.data(), 3, generatedNormals);
+			}
+
+			pool.parallelFor(primitive.positions.count, [&](size_t begin, size_t end) {
+				PROFILE_ZONE("PackGlbVertices");
+				glm::vec3 rangeMin(FLT_MAX), rangeMax(-FLT_MAX);
+				float source[SOURCE_STRIDE] = {};
+				for (size_t v = begin; v < end; v++) {
+					for (unsigned int c = 0; c < 3; c++) {
+						source[c] = primitive.positions.read(v, c);
+					}
+					rangeMin = glm::min(rangeMin, glm::vec3(source[0], source[1], source[2]));
+					rangeMax = glm::max(rangeMax, glm::vec3(source[0], source[1], source[2]));
+					// glTF puts the origin of the texture coordinates top left, OpenGL bottom left
+					source[3] = primitive.hasTexCoords ? primitive.texCoords.read(v, 0) : 0.0f;
+					source[4] = primitive.hasTexCoords ? 1.0f - primitive.texCoords.read(v, 1) : 0.0f;
+					glm::vec3 normal = primitive.hasNormals
+						? glm::vec3(primitive.normals.read(v, 0), primitive.normals.read(v, 1), primitive.normals.read(v, 2))
+						: generatedNormals[v];
+					normal = normalizeOrUp(normal);
+					memcpy(source + 5, &normal[0], 3 * sizeof(float));
+					format.packVertex(source, &mesh.vertices[(primitive.firstVertex + v) * mesh.stride]);
+				}
+				lock_guard<mutex> lock(boundsMutex);
+				mesh.boundsMin = glm::min(mesh.boundsMin, rangeMin);
+				mesh.boundsMax = glm::max(mesh.boundsMax, rangeMax);
+			}, 4096);
+		}
+		return true;
+	}
+
+	// Orders the triangles for the vertex cache, then the packed vertices in the order the triangles use them
+	inline void optimize(LoadedMesh& mesh) {
+		PROFILE_ZONE("OptimizeLoadedMesh");
+		size_t vertexCount = mesh.vertexCount();
+		MeshOptimizer::optimizeVertexCache(mesh.indices, vertexCount);
+
+		const unsigned int UNUSED = 0xFFFFFFFF;
+		vector<unsigned int> remap(vertexCount, UNUSED);
+		vector<unsigned char> vertices(mesh.vertices.size());
+		unsigned int used = 0;
+		for (unsigned int& index : mesh.indices) {
+			if (remap[index] == UNUSED) {
+				memcpy(&vertices[(size_t)used * mesh.stride], &mesh.vertices[(size_t)index * mesh.stride], mesh.stride);
+				remap[index] = used++;
+			}
+			index = remap[index];
+		}
+		vertices.resize((size_t)used * mesh.stride);
+		mesh.vertices.swap(vertices);
+	}
+
+	// Loads an .obj or .glb file, the extension decides which
+	inline bool load(const string& path, const VertexFormat& format, LoadedMesh& mesh, ThreadPool& pool = ThreadPool::shared()) {
+		PROFILE_ZONE("LoadMesh");
+		if (format.sourceStride() != SOURCE_STRIDE) {
+			cout << "ERROR::MESH_LOADER::FORMAT_NEEDS_POSITION_TEXCOORDS_NORMAL" << endl;
+			return false;
+		}
+		string extension = path.size() >= 4 ? path.substr(path.size() - 4) : "";
+		transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)tolower(c); });
+		if (extension != ".obj" && extension != ".glb") {
+			cout << "ERROR::MESH_LOADER::UNSUPPORTED_FORMAT " << path << endl;
+			return false;
+		}
+
+		MappedFile file(path);
+		if (!file.isOpen()) {
+			return false;
+		}
+		mesh = LoadedMesh();
+		bool loaded = extension == ".glb" ? loadGlb(file, format, mesh, pool) : loadObj(file, format, mesh, pool);
+		if (!loaded) {
+			cout << "ERROR::MESH_LOADER::FAILED " << path << endl;
+			mesh = LoadedMesh();
+			return false;
+		}
+		optimize(mesh);
+		return true;
+	}
+}
+
+#endif
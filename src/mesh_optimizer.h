@@ -0,0 +1,211 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+// A triangle list with shared vertices, each vertex is stride floats
+struct IndexedMesh {
+	vector<float> vertices;
+	vector<unsigned int> indices;
+	unsigned int stride = 0;
+
+	size_t vertexCount() const {
+		return stride == 0 ? 0 : vertices.size() / stride;
+	}
+};
+
+// Turns meshes into indexed triangle lists which are cheap for the GPU to process:
+//  1. weld: identical vertices are stored once and referenced by index
+//  2. optimizeVertexCache: triangles are reordered so recently transformed vertices are reused from the
+//     post-transform cache (Tipsify, Sander et al. 2007 "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw")
+//  3. optimizeVertexFetch: vertices are reordered into the order the triangles first use them, so fetching them
+//     walks through memory linearly
+// The average cache miss ratio (ACMR, transformed vertices per triangle) measures the result, 3 is the worst case
+// (nothing reused) and the number of vertices divided by the number of triangles the best one.
+namespace MeshOptimizer {
+	// Most GPUs have post-transform caches of about this many vertices
+	const unsigned int DEFAULT_CACHE_SIZE = 16;
+
+	// Builds an indexed mesh from a list of vertices where every three form a triangle
+	inline IndexedMesh weld(const float* vertices, size_t vertexCount, unsigned int stride) {
+		IndexedMesh mesh;
+		mesh.stride = stride;
+		mesh.indices.reserve(vertexCount);
+
+		// open addressing hash table of vertex indices, at most half full
+		size_t tableSize = 1;
+		while (tableSize < vertexCount * 2) {
+			tableSize <<= 1;
+		}
+		const unsigned int EMPTY = 0xFFFFFFFF;
+		vector<unsigned int> table(tableSize, EMPTY);
+
+		for (size_t i = 0; i < vertexCount; i++) {
+			const float* vertex = vertices + i * stride;
+
+			// FNV-1a over the bits of the floats, so only exactly equal vertices are welded
+			uint32_t hash = 2166136261u;
+			const unsigned char* bytes = (const unsigned char*)vertex;
+			for (size_t b = 0; b < stride * sizeof(float); b++) {
+				hash = (hash ^ bytes[b]) * 16777619u;
+			}
+
+			size_t slot = hash & (tableSize - 1);
+			while (table[slot] != EMPTY && memcmp(&mesh.vertices[table[slot] * stride], vertex, stride * sizeof(float)) != 0) {
+				slot = (slot + 1) & (tableSize - 1);
+			}
+			if (table[slot] == EMPTY) {
+				table[slot] = (unsigned int)mesh.vertexCount();
+				mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + stride);
+			}
+			mesh.indices.push_back(table[slot]);
+		}
+		return mesh;
+	}
+
+	// Simulates a FIFO post-transform cache and returns the transformed vertices per triangle
+	inline float averageCacheMissRatio(const vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = DEFAULT_CACHE_SIZE) {
+		if (indices.size() < 3) {
+			return 0.0f;
+		}
+		// a vertex is in the cache as long as fewer than cacheSize misses happened since it was inserted
+		vector<unsigned int> insertedAt(vertexCount, 0);
+		unsigned int misses = 0;
+		for (unsigned int index : indices) {
+			if (insertedAt[index] == 0 || misses - insertedAt[index] >= cacheSize) {
+				misses++;
+				insertedAt[index] = misses;
+			}
+		}
+		return (float)misses / (indices.size() / 3);
+	}
+
+	// Tipsify: emits the triangles around a "fanning" vertex, then continues with the vertex which is still in the
+	// cache and has the fewest remaining triangles. Runs in linear time, which matters for the larger meshes.
+	inline void optimizeVertexCache(vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = DEFAULT_CACHE_SIZE) {
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0) {
+			return;
+		}
+
+		// triangles using each vertex, stored as one array with offsets
+		vector<unsigned int> liveTriangles(vertexCount, 0);
+		for (unsigned int index : indices) {
+			liveTriangles[index]++;
+		}
+		vector<unsigned int> offsets(vertexCount + 1, 0);
+		for (size_t v = 0; v < vertexCount; v++) {
+			offsets[v + 1] = offsets[v] + liveTriangles[v];
+		}
+		vector<unsigned int> adjacency(indices.size());
+		vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t t = 0; t < triangleCount; t++) {
+			for (unsigned int corner = 0; corner < 3; corner++) {
+				adjacency[fill[indices[t * 3 + corner]]++] = (unsigned int)t;
+			}
+		}
+
+		vector<unsigned int> cacheTime(vertexCount, 0);
+		vector<bool> emitted(triangleCount, false);
+		vector<unsigned int> deadEnds;
+		vector<unsigned int> output;
+		output.reserve(indices.size());
+		unsigned int time = cacheSize + 1;
+		size_t cursor = 0;
+		long long fanning = 0;
+
+		while (fanning >= 0) {
+			vector<unsigned int> candidates;
+			for (unsigned int a = offsets[fanning]; a < offsets[fanning + 1]; a++) {
+				unsigned int t = adjacency[a];
+				if (emitted[t]) {
+					continue;
+				}
+				for (unsigned int corner = 0; corner < 3; corner++) {
+					unsigned int v = indices[t * 3 + corner];
+					output.push_back(v);
+					deadEnds.push_back(v);
+					candidates.push_back(v);
+					liveTriangles[v]--;
+					if (time - cacheTime[v] > cacheSize) {
+						cacheTime[v] = time;
+						time++;
+					}
+				}
+				emitted[t] = true;
+			}
+
+			// prefer the candidate which is still in the cache after its remaining triangles were emitted,
+			// among those the one which entered the cache first
+			fanning = -1;
+			int bestPriority = -1;
+			for (unsigned int v : candidates) {
+				if (liveTriangles[v] == 0) {
+					continue;
+				}
+				int priority = 0;
+				if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize) {
+					priority = (int)(time - cacheTime[v]);
+				}
+				if (priority > bestPriority) {
+					bestPriority = priority;
+					fanning = v;
+				}
+			}
+
+			// dead end: go back to a recently used vertex with triangles left, or the next one in input order
+			while (fanning < 0 && !deadEnds.empty()) {
+				unsigned int v = deadEnds.back();
+				deadEnds.pop_back();
+				if (liveTriangles[v] > 0) {
+					fanning = v;
+				}
+			}
+			while (fanning < 0 && cursor < vertexCount) {
+				if (liveTriangles[cursor] > 0) {
+					fanning = (long long)cursor;
+				}
+				cursor++;
+			}
+		}
+
+		indices.swap(output);
+	}
+
+	// Moves the vertices into the order the indices first reference them, unused vertices are dropped
+	inline void optimizeVertexFetch(IndexedMesh& mesh) {
+		const unsigned int UNUSED = 0xFFFFFFFF;
+		vector<unsigned int> remap(mesh.vertexCount(), UNUSED);
+		vector<float> vertices;
+		vertices.reserve(mesh.vertices.size());
+		for (unsigned int& index : mesh.indices) {
+			if (remap[index] == UNUSED) {
+				remap[index] = (unsigned int)(vertices.size() / mesh.stride);
+				vertices.insert(vertices.end(), mesh.vertices.begin() + index * mesh.stride, mesh.vertices.begin() + (index + 1) * mesh.stride);
+			}
+			index = remap[index];
+		}
+		mesh.vertices.swap(vertices);
+	}
+
+	// All three steps, the cache miss ratios before and after reordering are returned for reporting
+	inline IndexedMesh build(const float* vertices, size_t vertexCount, unsigned int stride, float* acmrBefore = NULL, float* acmrAfter = NULL) {
+		IndexedMesh mesh = weld(vertices, vertexCount, stride);
+		if (acmrBefore != NULL) {
+			// the welded mesh in the original triangle order
+			*acmrBefore = averageCacheMissRatio(mesh.indices, mesh.vertexCount());
+		}
+		optimizeVertexCache(mesh.indices, mesh.vertexCount());
+		optimizeVertexFetch(mesh);
+		if (acmrAfter != NULL) {
+			*acmrAfter = averageCacheMissRatio(mesh.indices, mesh.vertexCount());
+		}
+		return mesh;
+	}
+}
+
+#endif
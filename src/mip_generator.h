@@ -0,0 +1,359 @@
+#ifndef MIP_GENERATOR_H
+#define MIP_GENERATOR_H
+
+#include <glad/glad.h>
+
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include "profiler.h"
+#include "thread_pool.h"
+#include "texture_cache.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <xmmintrin.h>
+#define MIP_GENERATOR_SSE
+#endif
+
+using namespace std;
+
+// How each mip level is filtered from the one above it
+enum MipFilter {
+	// the average of 2x2 pixels, what glGenerateMipmap usually does
+	MIP_FILTER_BOX,
+	// a Kaiser windowed sinc over 12x12 pixels, keeps the smaller levels sharper without aliasing
+	MIP_FILTER_KAISER
+};
+
+// Builds the full mip chain of an image on the CPU, so the result no longer depends on the driver's
+// glGenerateMipmap and can be baked into the TextureCache.
+//  - The pixels are filtered in linear space: the image's sRGB colors are decoded, filtered and encoded again,
+//    otherwise averaging bright and dark pixels makes the smaller levels too dark. Alpha is linear anyway.
+//  - Filtering shrinks the area a cutout like grass.png covers, its thin blades fade away in the distance.
+//    For images with many fully transparent pixels the alpha of each level is scaled so the same share of
+//    pixels passes the alpha test as in the image (Castano, "Computing Alpha Mipmaps").
+// The filters are separable and work on one pixel (4 floats) per SSE register, the rows of a level are spread
+// across the thread pool.
+namespace MipGenerator {
+	// A level while it's filtered, 4 linear floats per pixel
+	struct Level {
+		unsigned int width = 0;
+		unsigned int height = 0;
+		vector<float> pixels;
+
+		float* pixel(unsigned int x, unsigned int y) {
+			return &pixels[((size_t)y * width + x) * 4];
+		}
+		const float* pixel(unsigned int x, unsigned int y) const {
+			return &pixels[((size_t)y * width + x) * 4];
+		}
+	};
+
+	// The alpha test reference coverage is kept for, the usual one
+	const float ALPHA_REFERENCE = 0.5f;
+	// Images with at least this share of fully transparent pixels are treated as cutouts
+	const float CUTOUT_SHARE = 0.1f;
+	// The Kaiser filter reaches this many pixels of the smaller level to both sides
+	const int KAISER_RADIUS = 3;
+	const int KAISER_TAPS = KAISER_RADIUS * 4;
+	const float KAISER_ALPHA = 4.0f;
+
+	inline const float* srgbToLinearTable() {
+		static const vector<float> table = []() {
+			vector<float> values(256);
+			for (int i = 0; i < 256; i++) {
+				float c = i / 255.0f;
+				values[i] = c <= 0.04045f ? c / 12.92f : pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			return values;
+		}();
+		return table.data();
+	}
+
+	inline float linearToSrgb(float c) {
+		c = min(max(c, 0.0f), 1.0f);
+		return c <= 0.0031308f ? c * 12.92f : 1.055f * pow(c, 1.0f / 2.4f) - 0.055f;
+	}
+
+	inline unsigned char toByte(float value) {
+		return (unsigned char)(min(max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+	}
+
+	// Weighted sum of pixels, one register per pixel
+	inline void accumulate(float* sum, const float* pixel, float weight) {
+#ifdef MIP_GENERATOR_SSE
+		_mm_storeu_ps(sum, _mm_add_ps(_mm_loadu_ps(sum), _mm_mul_ps(_mm_loadu_ps(pixel), _mm_set1_ps(weight))));
+#else
+		for (int c = 0; c < 4; c++) {
+			sum[c] += pixel[c] * weight;
+		}
+#endif
+	}
+
+	inline void downsampleBox(const Level& source, Level& destination, ThreadPool& pool) {
+		pool.parallelFor(destination.height, [&](size_t begin, size_t end) {
+			for (size_t y = begin; y < end; y++) {
+				// odd sizes and levels one pixel high or wide repeat the last row or column
+				unsigned int y0 = min((unsigned int)y * 2, source.height - 1), y1 = min((unsigned int)y * 2 + 1, source.height - 1);
+				for (unsigned int x = 0; x < destination.width; x++) {
+					unsigned int x0 = min(x * 2, source.width - 1), x1 = min(x * 2 + 1, source.width - 1);
+					float* output = destination.pixel(x, (unsigned int)y);
+					memset(output, 0, sizeof(float) * 4);
+					accumulate(output, source.pixel(x0, y0), 0.25f);
+					accumulate(output, source.pixel(x1, y0), 0.25f);
+					accumulate(output, source.pixel(x0, y1), 0.25f);
+					accumulate(output, source.pixel(x1, y1), 0.25f);
+				}
+			}
+		}, 4);
+	}
+
+	inline double besselI0(double x) {
+		double sum = 1.0, term = 1.0;
+		for (int k = 1; k < 32; k++) {
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+		}
+		return sum;
+	}
+
+	// The weights of the source pixels 2 x - 5 to 2 x + 6 for destination pixel x, normalized to sum up to 1
+	inline vector<float> kaiserWeights() {
+		const double PI = 3.14159265358979323846;
+		vector<float> weights(KAISER_TAPS);
+		double sum = 0.0;
+		for (int tap = 0; tap < KAISER_TAPS; tap++) {
+			// distance of the source pixel's center to the destination pixel's center, in source pixels
+			double distance = tap - (KAISER_TAPS - 1) / 2.0;
+			double x = distance / 2.0;
+			double sinc = x == 0.0 ? 1.0 : sin(PI * x) / (PI * x);
+			double window = x / KAISER_RADIUS;
+			double kaiser = fabs(window) >= 1.0 ? 0.0 : besselI0(KAISER_ALPHA * sqrt(1.0 - window * window)) / besselI0(KAISER_ALPHA);
+			weights[tap] = (float)(sinc * kaiser);
+			sum += weights[tap];
+		}
+		for (float& weight : weights) {
+			weight = (float)(weight / sum);
+		}
+		return weights;
+	}
+
+	// Filters the rows, then the columns. Pixels beyond the border repeat the border.
+	inline void downsampleKaiser(const Level& source, Level& destination, ThreadPool& pool) {
+		static const vector<float> weights = kaiserWeights();
+		const int first = -(KAISER_TAPS / 2 - 1);
+
+		// a dimension of 1 stays 1 and isn't filtered
+		Level rows;
+		rows.width = destination.width;
+		rows.height = source.height;
+		rows.pixels.assign((size_t)rows.width * rows.height * 4, 0.0f);
+		bool filterRows = source.width > 1;
+		pool.parallelFor(rows.height, [&](size_t begin, size_t end) {
+			for (size_t y = begin; y < end; y++) {
+				for (unsigned int x = 0; x < rows.width; x++) {
+					float* output = rows.pixel(x, (unsigned int)y);
+					if (!filterRows) {
+						memcpy(output, source.pixel(0, (unsigned int)y), sizeof(float) * 4);
+						continue;
+					}
+					for (int tap = 0; tap < KAISER_TAPS; tap++) {
+						int column = min(max((int)x * 2 + first + tap, 0), (int)source.width - 1);
+						accumulate(output, source.pixel(column, (unsigned int)y), weights[tap]);
+					}
+				}
+			}
+		}, 4);
+
+		bool filterColumns = source.height > 1;
+		pool.parallelFor(destination.height, [&](size_t begin, size_t end) {
+			for (size_t y = begin; y < end; y++) {
+				for (unsigned int x = 0; x < destination.width; x++) {
+					float* output = destination.pixel(x, (unsigned int)y);
+					if (!filterColumns) {
+						memcpy(output, rows.pixel(x, 0), sizeof(float) * 4);
+						continue;
+					}
+					memset(output, 0, sizeof(float) * 4);
+					for (int tap = 0; tap < KAISER_TAPS; tap++) {
+						int row = min(max((int)y * 2 + first + tap, 0), (int)rows.height - 1);
+						accumulate(output, rows.pixel(x, row), weights[tap]);
+					}
+				}
+			}
+		}, 4);
+	}
+
+	// Share of the pixels whose alpha, scaled, passes the alpha test
+	inline float coverage(const Level& level, float scale) {
+		size_t covered = 0;
+		size_t count = (size_t)level.width * level.height;
+		for (size_t i = 0; i < count; i++) {
+			if (level.pixels[i * 4 + 3] * scale > ALPHA_REFERENCE) {
+				covered++;
+			}
+		}
+		return (float)covered / count;
+	}
+
+	// Scales the level's alpha so the same share of pixels passes the alpha test as in the image
+	inline void preserveCoverage(Level& level, float targetCoverage) {
+		float low = 0.0f, high = 4.0f;
+		for (int step = 0; step < 16; step++) {
+			float scale = (low + high) / 2.0f;
+			if (coverage(level, scale) < targetCoverage) {
+				low = scale;
+			} else {
+				high = scale;
+			}
+		}
+		float scale = (low + high) / 2.0f;
+		size_t count = (size_t)level.width * level.height;
+		for (size_t i = 0; i < count; i++) {
+			level.pixels[i * 4 + 3] = min(level.pixels[i * 4 + 3] * scale, 1.0f);
+		}
+	}
+
+	// Converts a level back to bytes with the image's channels
+	inline void storeLevel(const Level& level, int channels, bool gammaCorrect, unsigned char* output, ThreadPool& pool) {
+		pool.parallelFor(level.height, [&](size_t begin, size_t end) {
+			for (size_t y = begin; y < end; y++) {
+				for (unsigned int x = 0; x < level.width; x++) {
+					const float* pixel = level.pixel(x, (unsigned int)y);
+					unsigned char* bytes = output + ((size_t)y * level.width + x) * channels;
+					for (int c = 0; c < channels; c++) {
+						bool color = channels >= 3 && c < 3;
+						bytes[c] = toByte(gammaCorrect && color ? linearToSrgb(pixel[c]) : pixel[c]);
+					}
+				}
+			}
+		}, 4);
+	}
+
+	// Scales an image to another size with a bilinear filter in linear space, for the TexturePacker's layers.
+	// Good for scaling up and down to half the size, below that it would skip pixels.
+	inline vector<unsigned char> resize(const unsigned char* pixels, unsigned int width, unsigned int height, int channels, unsigned int newWidth, unsigned int newHeight, bool gammaCorrect, ThreadPool& pool = ThreadPool::shared()) {
+		PROFILE_ZONE("ResizeImage");
+		const float* toLinear = srgbToLinearTable();
+		Level source;
+		source.width = width;
+		source.height = height;
+		source.pixels.assign((size_t)width * height * 4, 1.0f);
+		for (size_t i = 0; i < (size_t)width * height; i++) {
+			for (int c = 0; c < channels; c++) {
+				unsigned char byte = pixels[i * channels + c];
+				source.pixels[i * 4 + c] = gammaCorrect && channels >= 3 && c < 3 ? toLinear[byte] : byte / 255.0f;
+			}
+		}
+
+		Level scaled;
+		scaled.width = newWidth;
+		scaled.height = newHeight;
+		scaled.pixels.resize((size_t)newWidth * newHeight * 4);
+		float scaleX = (float)width / newWidth, scaleY = (float)height / newHeight;
+		pool.parallelFor(newHeight, [&](size_t begin, size_t end) {
+			for (size_t y = begin; y < end; y++) {
+				// pixel centers line up, the border pixels are repeated outside the image
+				float sourceY = min(max((y + 0.5f) * scaleY - 0.5f, 0.0f), (float)(height - 1));
+				unsigned int y0 = (unsigned int)sourceY, y1 = min(y0 + 1, height - 1);
+				float fy = sourceY - y0;
+				for (unsigned int x = 0; x < newWidth; x++) {
+					float sourceX = min(max((x + 0.5f) * scaleX - 0.5f, 0.0f), (float)(width - 1));
+					unsigned int x0 = (unsigned int)sourceX, x1 = min(x0 + 1, width - 1);
+					float fx = sourceX - x0;
+					float* sum = scaled.pixel(x, (unsigned int)y);
+					fill(sum, sum + 4, 0.0f);
+					accumulate(sum, source.pixel(x0, y0), (1.0f - fx) * (1.0f - fy));
+					accumulate(sum, source.pixel(x1, y0), fx * (1.0f - fy));
+					accumulate(sum, source.pixel(x0, y1), (1.0f - fx) * fy);
+					accumulate(sum, source.pixel(x1, y1), fx * fy);
+				}
+			}
+		}, 4);
+
+		vector<unsigned char> output((size_t)newWidth * newHeight * channels);
+		storeLevel(scaled, channels, gammaCorrect, output.data(), pool);
+		return output;
+	}
+
+	// Fills baked with the image and all of its smaller levels down to 1x1, tightly packed.
+	// channels is 1, 3 or 4, the TextureLoader decodes grey with alpha as RGBA.
+	inline void generate(const unsigned char* pixels, unsigned int width, unsigned int height, int channels, MipFilter filter, bool gammaCorrect, BakedTexture& baked, ThreadPool& pool = ThreadPool::shared()) {
+		PROFILE_ZONE("GenerateMips");
+		baked.format = channels == 1 ? GL_RED : channels == 3 ? GL_RGB : GL_RGBA;
+		baked.internalFormat = baked.format;
+		baked.type = GL_UNSIGNED_BYTE;
+		baked.levelCount = 0;
+		size_t offset = 0;
+		unsigned int levelWidth = width, levelHeight = height;
+		while (baked.levelCount < MAX_TEXTURE_LEVELS) {
+			TextureLevel& level = baked.levels[baked.levelCount++];
+			level.width = levelWidth;
+			level.height = levelHeight;
+			level.offset = offset;
+			level.size = (size_t)levelWidth * levelHeight * channels;
+			offset += level.size;
+			if (levelWidth == 1 && levelHeight == 1) {
+				break;
+			}
+			levelWidth = max(levelWidth / 2, 1u);
+			levelHeight = max(levelHeight / 2, 1u);
+		}
+		baked.storage.resize(offset);
+		baked.pixels = baked.storage.data();
+		baked.pixelBytes = baked.storage.size();
+		// the image itself is copied as it is
+		memcpy(baked.storage.data(), pixels, baked.levels[0].size);
+
+		const float* toLinear = srgbToLinearTable();
+		Level current;
+		current.width = width;
+		current.height = height;
+		current.pixels.resize((size_t)width * height * 4);
+		size_t transparent = 0;
+		for (size_t i = 0; i < (size_t)width * height; i++) {
+			for (int c = 0; c < 4; c++) {
+				float value;
+				if (channels == 1) {
+					// a single channel is a value, not a color
+					value = c == 0 ? pixels[i] / 255.0f : c == 3 ? 1.0f : 0.0f;
+				} else if (c < channels) {
+					unsigned char byte = pixels[i * channels + c];
+					value = gammaCorrect && c < 3 ? toLinear[byte] : byte / 255.0f;
+				} else {
+					value = 1.0f;
+				}
+				current.pixels[i * 4 + c] = value;
+			}
+			if (channels == 4 && pixels[i * 4 + 3] == 0) {
+				transparent++;
+			}
+		}
+		bool cutout = transparent >= CUTOUT_SHARE * width * height;
+		float targetCoverage = cutout ? coverage(current, 1.0f) : 0.0f;
+
+		for (unsigned int levelIndex = 1; levelIndex < baked.levelCount; levelIndex++) {
+			Level next;
+			next.width = baked.levels[levelIndex].width;
+			next.height = baked.levels[levelIndex].height;
+			next.pixels.resize((size_t)next.width * next.height * 4);
+			if (filter == MIP_FILTER_KAISER) {
+				downsampleKaiser(current, next, pool);
+			} else {
+				downsampleBox(current, next, pool);
+			}
+			// the next level is filtered from the unscaled alpha, so the scaling doesn't add up
+			Level stored = next;
+			if (cutout) {
+				preserveCoverage(stored, targetCoverage);
+			}
+			storeLevel(stored, channels, gammaCorrect, baked.storage.data() + baked.levels[levelIndex].offset, pool);
+			current = move(next);
+		}
+	}
+}
+
+#endif
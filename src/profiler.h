@@ -0,0 +1,167 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <cstdint>
+
+using namespace std;
+
+// A finished zone, the name has to be a string literal (or otherwise outlive the profiler)
+struct ProfileEvent {
+	const char* name;
+	uint64_t start;
+	uint64_t end;
+};
+
+// Fixed size ring buffer of zones which is only ever written by the thread owning it.
+// The write index is published with release semantics, so the exporter can read all finished zones
+// without any lock. When the buffer is full the oldest zones are overwritten.
+class ProfileRingBuffer {
+public:
+	static const uint32_t CAPACITY = 1 << 16;
+
+	ProfileRingBuffer(uint32_t threadId, const char* trackName) : threadId(threadId), trackName(trackName) {
+	}
+
+	void push(const char* name, uint64_t start, uint64_t end) {
+		uint64_t index = writeIndex.load(memory_order_relaxed);
+		ProfileEvent& event = events[index & (CAPACITY - 1)];
+		event.name = name;
+		event.start = start;
+		event.end = end;
+		writeIndex.store(index + 1, memory_order_release);
+	}
+
+	uint32_t threadId;
+	// Shown instead of the thread id for tracks which aren't CPU threads
+	const char* trackName;
+	atomic<uint64_t> writeIndex{ 0 };
+	ProfileEvent events[CAPACITY];
+};
+
+// Collects the zones of all threads and exports them in the Chrome trace event format
+// (open the file in chrome://tracing or https://ui.perfetto.dev)
+class Profiler {
+public:
+	static Profiler& instance() {
+		static Profiler profiler;
+		return profiler;
+	}
+
+	// Nanoseconds since the profiler was created
+	static uint64_t now() {
+		return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - instance().origin).count();
+	}
+
+	// Recording can be switched off at runtime, a disabled zone costs a single relaxed load
+	void setEnabled(bool value) {
+		enabled.store(value, memory_order_relaxed);
+	}
+
+	bool isEnabled() const {
+		return enabled.load(memory_order_relaxed);
+	}
+
+	// The buffer of the calling thread, created on first use
+	ProfileRingBuffer& threadBuffer() {
+		thread_local ProfileRingBuffer* buffer = NULL;
+		if (buffer == NULL) {
+			buffer = &createBuffer(NULL);
+		}
+		return *buffer;
+	}
+
+	// A separate track for events which don't belong to a CPU thread (e.g. GPU timings).
+	// Like the thread buffers it must only be written by a single thread.
+	ProfileRingBuffer& createTrack(const char* name) {
+		return createBuffer(name);
+	}
+
+	bool writeChromeTrace(const char* path) {
+		ofstream file(path);
+		if (!file) {
+			cout << "ERROR::PROFILER::TRACE_NOT_WRITABLE " << path << endl;
+			return false;
+		}
+
+		lock_guard<mutex> lock(buffersMutex);
+		file << fixed << setprecision(3);
+		file << "{\"traceEvents\":[\n";
+		bool first = true;
+		for (const unique_ptr<ProfileRingBuffer>& buffer : buffers) {
+			if (buffer->trackName != NULL) {
+				file << (first ? "" : ",\n")
+					<< "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+					<< ",\"args\":{\"name\":\"" << buffer->trackName << "\"}}";
+				first = false;
+			}
+			uint64_t end = buffer->writeIndex.load(memory_order_acquire);
+			uint64_t begin = end > ProfileRingBuffer::CAPACITY ? end - ProfileRingBuffer::CAPACITY : 0;
+			for (uint64_t i = begin; i < end; i++) {
+				const ProfileEvent& event = buffer->events[i & (ProfileRingBuffer::CAPACITY - 1)];
+				// Chrome expects microseconds
+				file << (first ? "" : ",\n")
+					<< "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+					<< ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+				first = false;
+			}
+		}
+		file << "\n]}\n";
+
+		cout << "Profiler trace written to " << path << endl;
+		return true;
+	}
+
+private:
+	Profiler() : origin(chrono::steady_clock::now()) {
+	}
+
+	ProfileRingBuffer& createBuffer(const char* trackName) {
+		// Registering a thread or track is the only place which takes a lock
+		lock_guard<mutex> lock(buffersMutex);
+		buffers.push_back(unique_ptr<ProfileRingBuffer>(new ProfileRingBuffer((uint32_t)buffers.size() + 1, trackName)));
+		return *buffers.back();
+	}
+
+	chrono::steady_clock::time_point origin;
+	atomic<bool> enabled{ true };
+	mutex buffersMutex;
+	vector<unique_ptr<ProfileRingBuffer>> buffers;
+};
+
+// Measures the lifetime of the scope it lives in
+class ProfileZone {
+public:
+	explicit ProfileZone(const char* name) : name(name), start(0) {
+		if (Profiler::instance().isEnabled()) {
+			start = Profiler::now();
+		} else {
+			this->name = NULL;
+		}
+	}
+
+	~ProfileZone() {
+		if (name != NULL) {
+			uint64_t end = Profiler::now();
+			Profiler::instance().threadBuffer().push(name, start, end);
+		}
+	}
+
+private:
+	const char* name;
+	uint64_t start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// Profile the enclosing scope under the given name
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+
+#endif
@@ -0,0 +1,197 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <filesystem>
+
+#include "mapped_file.h"
+
+using namespace std;
+
+// Stores linked programs on disk with glGetProgramBinary and loads them again with glProgramBinary,
+// which skips compiling and linking the GLSL sources on the next launch.
+// A binary only works with the exact driver that produced it, so the cache key is a hash of the
+// shader sources together with the GL vendor, renderer and version strings. A binary the driver
+// rejects (e.g. after a driver update) is treated like a cache miss and overwritten.
+class ProgramCache {
+public:
+	static ProgramCache& instance() {
+		static ProgramCache cache;
+		return cache;
+	}
+
+	// Needs GL_ARB_get_program_binary (core since OpenGL 4.1) and at least one binary format
+	bool isSupported() {
+		if (supported < 0) {
+			GLint formats = 0;
+			if (GLAD_GL_ARB_get_program_binary) {
+				glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+			}
+			supported = formats > 0 ? 1 : 0;
+		}
+		return supported == 1;
+	}
+
+	// Identifies the program in the cache
+	uint64_t key(const string& vertexCode, const string& fragmentCode) {
+		uint64_t hash = FNV_OFFSET;
+		hash = fnv1a(hash, vertexCode);
+		hash = fnv1a(hash, fragmentCode);
+		hash = fnv1a(hash, driverString());
+		return hash;
+	}
+
+	// Creates a program from the cached binary, returns 0 on a cache miss
+	unsigned int load(uint64_t key) {
+		if (!isSupported()) {
+			return 0;
+		}
+
+		ifstream file(path(key), ios::binary);
+		if (!file) {
+			misses++;
+			return 0;
+		}
+
+		Header header;
+		file.read((char*)&header, sizeof(header));
+		// the length comes from the file, check it against the file's size before allocating that much
+		error_code error;
+		uintmax_t fileSize = filesystem::file_size(path(key), error);
+		bool valid = file && !error && header.magic == MAGIC && header.version == VERSION && header.key == key
+			&& header.length > 0 && header.length <= fileSize - sizeof(header);
+		if (!valid) {
+			misses++;
+			return 0;
+		}
+		vector<char> binary(header.length);
+		file.read(binary.data(), binary.size());
+		if (!file) {
+			misses++;
+			return 0;
+		}
+
+		unsigned int id = glCreateProgram();
+		glProgramBinary(id, header.format, binary.data(), (GLsizei)binary.size());
+		int success = 0;
+		glGetProgramiv(id, GL_LINK_STATUS, &success);
+		if (!success) {
+			// The driver changed in a way its version string doesn't tell, compile from source again
+			glDeleteProgram(id);
+			misses++;
+			return 0;
+		}
+
+		hits++;
+		return id;
+	}
+
+	// Call before glLinkProgram, otherwise some drivers won't keep the binary around
+	void prepare(unsigned int id) {
+		if (isSupported()) {
+			glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+	}
+
+	// Writes the binary of a successfully linked program into the cache
+	void store(uint64_t key, unsigned int id) {
+		if (!isSupported()) {
+			return;
+		}
+
+		GLint length = 0;
+		glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0) {
+			return;
+		}
+
+		Header header;
+		header.magic = MAGIC;
+		header.version = VERSION;
+		header.key = key;
+		vector<char> binary(length);
+		GLsizei written = 0;
+		glGetProgramBinary(id, length, &written, &header.format, binary.data());
+		header.length = (uint32_t)written;
+
+		error_code error;
+		filesystem::create_directories(directory, error);
+		// write under a name of our own and rename, so a half written binary is never loaded by the next run
+		string cachePath = path(key);
+		string temporaryPath = uniqueTemporaryPath(cachePath);
+		{
+			ofstream file(temporaryPath, ios::binary | ios::trunc);
+			if (!file) {
+				cout << "ERROR::PROGRAM_CACHE::NOT_WRITABLE " << temporaryPath << endl;
+				return;
+			}
+			file.write((const char*)&header, sizeof(header));
+			file.write(binary.data(), written);
+			if (!file) {
+				cout << "ERROR::PROGRAM_CACHE::WRITE_FAILED " << temporaryPath << endl;
+				file.close();
+				filesystem::remove(temporaryPath, error);
+				return;
+			}
+		}
+		filesystem::rename(temporaryPath, cachePath, error);
+		if (error) {
+			cout << "ERROR::PROGRAM_CACHE::NOT_WRITABLE " << cachePath << endl;
+			filesystem::remove(temporaryPath, error);
+		}
+	}
+
+	// Where the binaries are stored, relative to the working directory
+	string directory = "cache/programs";
+
+	unsigned int hits = 0;
+	unsigned int misses = 0;
+
+private:
+	static const uint32_t MAGIC = 0x4250474C; // "LGPB"
+	// Increase whenever the file layout changes
+	static const uint32_t VERSION = 2;
+	static const uint64_t FNV_OFFSET = 14695981039346656037ull;
+	static const uint64_t FNV_PRIME = 1099511628211ull;
+
+	struct Header {
+		uint32_t magic = 0;
+		uint32_t version = 0;
+		uint64_t key = 0;
+		GLenum format = 0;
+		uint32_t length = 0;
+	};
+
+	int supported = -1;
+	string driver;
+
+	const string& driverString() {
+		if (driver.empty()) {
+			driver = string((const char*)glGetString(GL_VENDOR)) + "|" + (const char*)glGetString(GL_RENDERER) + "|" + (const char*)glGetString(GL_VERSION);
+		}
+		return driver;
+	}
+
+	static uint64_t fnv1a(uint64_t hash, const string& text) {
+		for (unsigned char c : text) {
+			hash = (hash ^ c) * FNV_PRIME;
+		}
+		// Separate the strings so "ab" + "c" and "a" + "bc" don't collide
+		return (hash ^ 0xFF) * FNV_PRIME;
+	}
+
+	string path(uint64_t key) const {
+		stringstream name;
+		name << directory << "/" << hex << key << ".bin";
+		return name.str();
+	}
+};
+
+#endif
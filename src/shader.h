@@ -7,123 +7,430 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <cstring>
+#include <algorithm>
+#include <thread>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
+#include "state_cache.h"
+#include "shader_preprocessor.h"
+#include "program_cache.h"
+#include "profiler.h"
+
 using namespace std;
 
+class ShaderBatch;
+
+// A uniform location resolved once after linking, the type makes sure only matching values can be uploaded
+template<typename T>
+struct UniformHandle {
+	int location = -1;
+};
+
+// An active uniform of a linked program as reported by glGetActiveUniform
+struct UniformInfo {
+	string name;
+	GLenum type;
+	int size;
+	int location;
+};
+
 class Shader {
 public:
 	// shader program id
 	unsigned int id;
+	// all active uniforms of the program, filled once after linking
+	vector<UniformInfo> uniforms;
+	// the files the program was built from
+	string vertexPath;
+	string fragmentPath;
+	// the compile time defines of this variant
+	ShaderDefines defines;
+	// vertexPath, fragmentPath and every file they include
+	vector<string> dependencies;
+
+	// constructor reads and builds the shader. With a batch the sources are only handed to the driver and
+	// the program is not usable before ShaderBatch::finish() returns, see ShaderBatch below.
+	Shader(const char* vertexPath, const char* fragmentPath, ShaderBatch* batch = NULL);
+	// builds the variant of the shader with the given defines
+	Shader(const char* vertexPath, const char* fragmentPath, const ShaderDefines& defines, ShaderBatch* batch = NULL);
+
+	// use/activate the shader (skipped if it is already in use)
+	void use() {
+		GLStateCache::instance().useProgram(id);
+	}
+
+	// true if the program was built from the file (directly or through an #include)
+	bool uses(const string& path) const {
+		return find(dependencies.begin(), dependencies.end(), ShaderPreprocessor::normalize(path)) != dependencies.end();
+	}
+
+	// Build the program again with the new source of one of its files. The new program only replaces the
+	// current one if it links, otherwise the errors are printed and the old program stays in use.
+	// Uniform locations may change, so handles have to be resolved again and uniform blocks, samplers and other
+	// uniforms set up again when this returns true.
+	bool reload(const string& path, const string& code) {
+		PROFILE_ZONE("ReloadShader");
+		unsigned int previousId = id;
+		map<string, string> previousFiles = files;
+		vector<UniformInfo> previousUniforms = uniforms;
+		files[ShaderPreprocessor::normalize(path)] = code;
+
+		submitSources();
+		if (!finish()) {
+			cout << "ERROR::SHADER::RELOAD_FAILED " << path << " (keeping the previous program)" << endl;
+			glDeleteProgram(id);
+			id = previousId;
+			files = previousFiles;
+			uniforms = previousUniforms;
+			return false;
+		}
+
+		// The driver may hand out the old id again, so the state cache must not believe it is still bound
+		glDeleteProgram(previousId);
+		GLStateCache::instance().invalidate();
+		cout << "Reloaded " << path << endl;
+		return true;
+	}
+
+	// connect a uniform block of the program to a uniform buffer binding point
+	void bindUniformBlock(const char* name, unsigned int binding) const {
+		unsigned int index = glGetUniformBlockIndex(id, name);
+		if (index != GL_INVALID_INDEX) {
+			glUniformBlockBinding(id, index, binding);
+		}
+	}
+
+	// resolve a uniform once and keep the handle, uniforms which are not active (e.g. optimized away) get location -1
+	// which OpenGL silently ignores
+	template<typename T>
+	UniformHandle<T> uniform(const char* name) const {
+		UniformHandle<T> handle;
+		const UniformInfo* info = findUniform(name);
+		if (info != NULL) {
+			if (!matchesType(info->type, (T*)NULL)) {
+				cout << "ERROR::SHADER::UNIFORM_TYPE_MISMATCH " << name << endl;
+			} else {
+				handle.location = info->location;
+			}
+		}
+		return handle;
+	}
+
+	// utility uniform functions for resolved handles, these are plain uploads to the shader in use
+	void set(UniformHandle<bool> handle, bool value) const {
+		glUniform1i(handle.location, (int)value);
+	}
+	void set(UniformHandle<int> handle, int value) const {
+		glUniform1i(handle.location, value);
+	}
+	void set(UniformHandle<float> handle, float value) const {
+		glUniform1f(handle.location, value);
+	}
+	void set(UniformHandle<glm::vec3> handle, const glm::vec3& value) const {
+		glUniform3fv(handle.location, 1, glm::value_ptr(value));
+	}
+	void set(UniformHandle<glm::mat3> handle, const glm::mat3& value) const {
+		glUniformMatrix3fv(handle.location, 1, GL_FALSE, glm::value_ptr(value));
+	}
+	void set(UniformHandle<glm::mat4> handle, const glm::mat4& value) const {
+		glUniformMatrix4fv(handle.location, 1, GL_FALSE, glm::value_ptr(value));
+	}
+
+	// utility unfirm functions by name, they search the uniform table on every call so prefer handles in the render loop
+	void setBool(const string& name, bool value) const {
+		glUniform1i(location(name.c_str()), (int)value);
+	}
+	void setInt(const string& name, int value) const {
+		glUniform1i(location(name.c_str()), value);
+	}
+	void setFloat(const string& name, float value) const {
+		glUniform1f(location(name.c_str()), value);
+	}
+	void setVec3(const string& name, glm::vec3 value) const {
+		glUniform3fv(location(name.c_str()), 1, glm::value_ptr(value));
+	}
+	void setVec3(const string& name, float x, float y, float z) const {
+		glUniform3f(location(name.c_str()), x, y, z);
+	}
+	void setMat4(const string& name, glm::mat4 value) const {
+		glUniformMatrix4fv(location(name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+	}
+
+private:
+	friend class ShaderBatch;
 
-	// constructor reads and builds the shader
-	Shader(const char* vertexPath, const char* fragmentPath) {
-		// 1. retrieve the vertex/fragment shader source code
+	// state between submit() and finish(), the shader objects are 0 when the program came from the cache
+	unsigned int vertex = 0;
+	unsigned int fragment = 0;
+	uint64_t cacheKey = 0;
+	bool pending = false;
+
+	// the contents of all dependencies, kept for reload()
+	map<string, string> files;
+	// the files of each stage, the index is the source string number in the compiler's messages
+	vector<string> vertexFiles;
+	vector<string> fragmentFiles;
+
+	// 1. remember what to build, the files are read when the sources are put together
+	void submit(const char* vertexPath, const char* fragmentPath) {
+		this->vertexPath = ShaderPreprocessor::normalize(vertexPath);
+		this->fragmentPath = ShaderPreprocessor::normalize(fragmentPath);
+		files.clear();
+		submitSources();
+	}
+
+	// 2. resolve the includes and defines and start compiling and linking, nothing here waits for the driver
+	void submitSources() {
 		string vertexCode;
 		string fragmentCode;
-		ifstream vertexShaderFile;
-		ifstream fragmentShaderFile;
-
-		// setup vertex and fragment shader ifstream exceptions
-		vertexShaderFile.exceptions(ifstream::failbit | ifstream::badbit);
-		fragmentShaderFile.exceptions(ifstream::failbit | ifstream::badbit);
-
-		try {
-			// open shader files
-			vertexShaderFile.open(vertexPath);
-			fragmentShaderFile.open(fragmentPath);
-			stringstream vertexShaderStream, fragmentShaderStream;
-
-			// read file buffer contents into streams
-			vertexShaderStream << vertexShaderFile.rdbuf();
-			fragmentShaderStream << fragmentShaderFile.rdbuf();
-
-			// close file handlers
-			vertexShaderFile.close();
-			fragmentShaderFile.close();
-
-			// convert stream into string;
-			vertexCode = vertexShaderStream.str();
-			fragmentCode = fragmentShaderStream.str();
-		} catch (ifstream::failure e) {
-			cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << endl;
-			cout << e.code() << "  " << e.what() << endl;
+		ShaderPreprocessor preprocessor(files);
+		preprocessor.process(vertexPath, defines, vertexCode);
+		vertexFiles = preprocessor.dependencies;
+		preprocessor.process(fragmentPath, defines, fragmentCode);
+		fragmentFiles = preprocessor.dependencies;
+
+		dependencies = vertexFiles;
+		for (const string& file : fragmentFiles) {
+			if (find(dependencies.begin(), dependencies.end(), file) == dependencies.end()) {
+				dependencies.push_back(file);
+			}
+		}
+
+		pending = true;
+
+		// try the binary the driver produced the last time it built exactly these sources
+		ProgramCache& programCache = ProgramCache::instance();
+		cacheKey = programCache.key(vertexCode, fragmentCode);
+		id = programCache.load(cacheKey);
+		if (id != 0) {
+			return;
 		}
 
 		const char* vertexShaderCode = vertexCode.c_str();
 		const char* fragmentShaderCode = fragmentCode.c_str();
 
-		// 2. compile and link shaders
-		unsigned int vertex, fragment;
-		int success;
-		char infoLog[512];
-
-		// vertex shader
+		// 2. compile and link shaders. Asking for the compile status right away would make the driver finish
+		// compiling first, so we link straight away and only look at the status in finish()
 		vertex = glCreateShader(GL_VERTEX_SHADER);
 		glShaderSource(vertex, 1, &vertexShaderCode, NULL);
 		glCompileShader(vertex);
-		// print compile errors if any occured
-		glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-		if (!success) {
-			glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-			cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << endl;
-		}
 
-		// fragment shader
 		fragment = glCreateShader(GL_FRAGMENT_SHADER);
 		glShaderSource(fragment, 1, &fragmentShaderCode, NULL);
 		glCompileShader(fragment);
-		// print compile errors if any occured
-		glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-		if (!success) {
-			glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-			cout << "ERROR::SHADER:FRAGMENT_COMPILATION_FAILED\n" << infoLog << endl;
-		}
 
 		// create the actual shader program
 		id = glCreateProgram();
 		// link shaders
 		glAttachShader(id, vertex);
 		glAttachShader(id, fragment);
+		programCache.prepare(id);
 		glLinkProgram(id);
-		// print linking error if any occured
-		glGetProgramiv(id, GL_LINK_STATUS, &success);
-		if (!success) {
-			glGetProgramInfoLog(id, 512, NULL, infoLog);
-			cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << endl;
+	}
+
+	// true once finish() won't block, only drivers with KHR_parallel_shader_compile can tell in advance
+	bool isReady() const {
+		if (!pending || vertex == 0 || !GLAD_GL_KHR_parallel_shader_compile) {
+			return true;
+		}
+		int done = 0;
+		glGetProgramiv(id, GL_COMPLETION_STATUS_KHR, &done);
+		return done != 0;
+	}
+
+	// check the results of submit(), this waits for the driver if it is still compiling.
+	// Returns false if the program didn't link.
+	bool finish() {
+		if (!pending) {
+			return true;
+		}
+		pending = false;
+
+		int success = 1;
+		if (vertex != 0) {
+			char infoLog[512];
+
+			// print compile errors if any occured
+			glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
+			if (!success) {
+				glGetShaderInfoLog(vertex, 512, NULL, infoLog);
+				cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << endl;
+				printFiles(vertexFiles);
+			}
+			glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
+			if (!success) {
+				glGetShaderInfoLog(fragment, 512, NULL, infoLog);
+				cout << "ERROR::SHADER:FRAGMENT_COMPILATION_FAILED\n" << infoLog << endl;
+				printFiles(fragmentFiles);
+			}
+
+			// print linking error if any occured
+			glGetProgramiv(id, GL_LINK_STATUS, &success);
+			if (!success) {
+				glGetProgramInfoLog(id, 512, NULL, infoLog);
+				cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << endl;
+			} else {
+				// keep the binary so the next launch can skip compiling
+				ProgramCache::instance().store(cacheKey, id);
+			}
+
+			// delete the shaders as they are linked to the program now and are no longer needed
+			glDeleteShader(vertex);
+			glDeleteShader(fragment);
+			vertex = 0;
+			fragment = 0;
 		}
 
-		// delete the shaders as they are linked to the program now and are no longer needed
-		glDeleteShader(vertex);
-		glDeleteShader(fragment);
+		// 3. look up all uniform locations once, so setting a uniform never has to ask the driver again
+		loadUniforms();
+		return success != 0;
 	}
 
-	// use/activate the shader
-	void use() {
-		glUseProgram(id);
+	// which source string number in the compiler's messages belongs to which file
+	static void printFiles(const vector<string>& stageFiles) {
+		for (size_t i = 0; i < stageFiles.size(); i++) {
+			cout << "  " << i << ": " << stageFiles[i] << endl;
+		}
 	}
 
-	// utility unfirm functions
-	void setBool(const string& name, bool value) const {
-		glUniform1i(glGetUniformLocation(id, name.c_str()), (int)value);
+	void loadUniforms() {
+		uniforms.clear();
+		int count = 0;
+		glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+		for (int i = 0; i < count; i++) {
+			char name[256];
+			GLsizei length = 0;
+			UniformInfo info;
+			glGetActiveUniform(id, (GLuint)i, sizeof(name), &length, &info.size, &info.type, name);
+			// arrays are reported as "name[0]", we look them up by their plain name
+			if (length > 3 && strcmp(name + length - 3, "[0]") == 0) {
+				name[length - 3] = '\0';
+			}
+			info.name = name;
+			// uniforms inside uniform blocks have no location
+			info.location = glGetUniformLocation(id, name);
+			uniforms.push_back(info);
+		}
 	}
-	void setInt(const string& name, int value) const {
-		glUniform1i(glGetUniformLocation(id, name.c_str()), value);
+
+	const UniformInfo* findUniform(const char* name) const {
+		for (const UniformInfo& info : uniforms) {
+			if (info.name == name) {
+				return &info;
+			}
+		}
+		return NULL;
 	}
-	void setFloat(const string& name, float value) const {
-		glUniform1f(glGetUniformLocation(id, name.c_str()), value);
+
+	int location(const char* name) const {
+		const UniformInfo* info = findUniform(name);
+		return info != NULL ? info->location : -1;
 	}
-	void setVec3(const string& name, glm::vec3 value) const {
-		glUniform3fv(glGetUniformLocation(id, name.c_str()), 1, glm::value_ptr(value));
+
+	// samplers are set with glUniform1i, so they accept int handles
+	static bool matchesType(GLenum type, bool*) { return type == GL_BOOL || type == GL_INT; }
+	static bool matchesType(GLenum type, int*) { return type == GL_INT || type == GL_BOOL || type == GL_SAMPLER_2D || type == GL_SAMPLER_2D_ARRAY || type == GL_SAMPLER_CUBE || type == GL_SAMPLER_3D; }
+	static bool matchesType(GLenum type, float*) { return type == GL_FLOAT; }
+	static bool matchesType(GLenum type, glm::vec3*) { return type == GL_FLOAT_VEC3; }
+	static bool matchesType(GLenum type, glm::mat3*) { return type == GL_FLOAT_MAT3; }
+	static bool matchesType(GLenum type, glm::mat4*) { return type == GL_FLOAT_MAT4; }
+};
+
+// Builds several programs at the same time. Every program is submitted first and the compile and link status
+// is only queried once all of them are on their way, so the driver can compile them in parallel (and in the
+// background while we read the next sources) instead of finishing each program before the next one starts.
+// With KHR_parallel_shader_compile we also let the driver use as many compiler threads as it likes and finish
+// the programs in the order they become ready.
+//
+//	ShaderBatch batch;
+//	Shader a("a.vert", "a.frag", &batch);
+//	Shader b("b.vert", "b.frag", &batch);
+//	batch.finish(); // a and b can be used from here on
+class ShaderBatch {
+public:
+	ShaderBatch() {
+		if (GLAD_GL_KHR_parallel_shader_compile) {
+			// 0xFFFFFFFF lets the driver pick the number of threads
+			glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+		}
 	}
-	void setVec3(const string& name, float x, float y, float z) const {
-		glUniform3f(glGetUniformLocation(id, name.c_str()), x, y, z);
+
+	void add(Shader& shader) {
+		shaders.push_back(&shader);
 	}
-	void setMat4(const string& name, glm::mat4 value) const {
-		glUniformMatrix4fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+
+	// Waits for all submitted programs and checks their status, the shaders must not have moved since they were added
+	void finish() {
+		PROFILE_ZONE("FinishShaders");
+		while (!shaders.empty()) {
+			bool progress = false;
+			for (size_t i = 0; i < shaders.size();) {
+				if (shaders[i]->isReady()) {
+					shaders[i]->finish();
+					shaders.erase(shaders.begin() + i);
+					progress = true;
+				} else {
+					i++;
+				}
+			}
+			if (!progress) {
+				this_thread::yield();
+			}
+		}
+	}
+
+private:
+	vector<Shader*> shaders;
+};
+
+// Hands out one shared program per combination of files and defines, so asking for a variant twice neither
+// compiles it twice nor ends up with two identical programs the render loop has to switch between
+class ShaderVariantCache {
+public:
+	// The program is built on the first request, with a batch it is usable once the batch is finished
+	Shader& get(const char* vertexPath, const char* fragmentPath, const ShaderDefines& defines = ShaderDefines(), ShaderBatch* batch = NULL) {
+		requests++;
+		string key = ShaderPreprocessor::normalize(vertexPath) + "|" + ShaderPreprocessor::normalize(fragmentPath) + "|" + defines.key();
+		unique_ptr<Shader>& variant = variants[key];
+		if (variant == NULL) {
+			variant.reset(new Shader(vertexPath, fragmentPath, defines, batch));
+		}
+		return *variant;
+	}
+
+	// All variants built so far, e.g. to reload the ones using a changed file
+	vector<Shader*> programs() const {
+		vector<Shader*> result;
+		for (const auto& variant : variants) {
+			result.push_back(variant.second.get());
+		}
+		return result;
+	}
+
+	// How often get() was called, the difference to programs().size() are the compiles we saved
+	unsigned int requests = 0;
+
+private:
+	map<string, unique_ptr<Shader>> variants;
+};
+
+inline Shader::Shader(const char* vertexPath, const char* fragmentPath, ShaderBatch* batch) : Shader(vertexPath, fragmentPath, ShaderDefines(), batch) {
+}
+
+inline Shader::Shader(const char* vertexPath, const char* fragmentPath, const ShaderDefines& defines, ShaderBatch* batch) : id(0), defines(defines) {
+	PROFILE_ZONE("BuildShader");
+	submit(vertexPath, fragmentPath);
+	if (batch != NULL) {
+		batch->add(*this);
+	} else {
+		finish();
 	}
-};		
+}
 
 #endif
\ No newline at end of file
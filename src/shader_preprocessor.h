@@ -0,0 +1,165 @@
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <utility>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <initializer_list>
+
+using namespace std;
+
+// Compile time defines of a shader variant. They are kept sorted by name, so the same set always gives the same key.
+// A value known at compile time lets the GLSL compiler fold it into the code instead of reading a uniform per fragment.
+class ShaderDefines {
+public:
+	ShaderDefines() {
+	}
+
+	ShaderDefines(initializer_list<pair<string, string>> list) {
+		for (const pair<string, string>& define : list) {
+			set(define.first, define.second);
+		}
+	}
+
+	ShaderDefines& set(const string& name, const string& value = "1") {
+		auto position = lower_bound(defines.begin(), defines.end(), name,
+			[](const pair<string, string>& define, const string& name) { return define.first < name; });
+		if (position != defines.end() && position->first == name) {
+			position->second = value;
+		} else {
+			defines.insert(position, make_pair(name, value));
+		}
+		return *this;
+	}
+
+	// Identifies the set, e.g. "SHININESS=32.0;SPECULAR=1"
+	string key() const {
+		string result;
+		for (const pair<string, string>& define : defines) {
+			result += define.first + "=" + define.second + ";";
+		}
+		return result;
+	}
+
+	// The #define lines which are inserted after the #version line
+	string source() const {
+		string result;
+		for (const pair<string, string>& define : defines) {
+			result += "#define " + define.first + " " + define.second + "\n";
+		}
+		return result;
+	}
+
+private:
+	vector<pair<string, string>> defines;
+};
+
+// Turns a shader file into the source which is handed to OpenGL:
+//  - #include "file" is replaced by the file, the path is relative to the including file. Every file is included
+//    at most once, so shared files need no include guards.
+//  - the defines are inserted right after the #version line (which has to stay the first line).
+// #line directives keep the line numbers in the compiler's messages right, the source string number of a line is
+// the index of its file in dependencies.
+class ShaderPreprocessor {
+public:
+	// The contents of the files by path, files which are not in here yet are read from disk and added
+	map<string, string>& files;
+	// Every file the output was built from, the first one is the shader itself
+	vector<string> dependencies;
+
+	explicit ShaderPreprocessor(map<string, string>& files) : files(files) {
+	}
+
+	// Returns false if a file could not be read
+	bool process(const string& path, const ShaderDefines& defines, string& output) {
+		dependencies.clear();
+		output.clear();
+		bool success = expand(normalize(path), output);
+
+		// GLSL wants the #version line before anything else, so the defines go right after it
+		size_t version = output.find("#version");
+		size_t insert = version == string::npos ? 0 : output.find('\n', version);
+		insert = insert == string::npos ? output.size() : insert + 1;
+		unsigned int versionLine = (unsigned int)count(output.begin(), output.begin() + insert, '\n');
+		output.insert(insert, defines.source() + "#line " + to_string(versionLine + 1) + " 0\n");
+		return success;
+	}
+
+	// Paths are compared as strings, so all of them are stored the same way
+	static string normalize(const string& path) {
+		return filesystem::path(path).lexically_normal().generic_string();
+	}
+
+private:
+	bool expand(const string& path, string& output) {
+		if (find(dependencies.begin(), dependencies.end(), path) != dependencies.end()) {
+			return true;
+		}
+		unsigned int index = (unsigned int)dependencies.size();
+		dependencies.push_back(path);
+
+		const string* code = load(path);
+		if (code == NULL) {
+			return false;
+		}
+
+		bool success = true;
+		stringstream lines(*code);
+		string line;
+		unsigned int number = 0;
+		while (getline(lines, line)) {
+			number++;
+			string include;
+			if (!parseInclude(line, include)) {
+				output += line + "\n";
+				continue;
+			}
+
+			string includePath = normalize((filesystem::path(path).parent_path() / include).string());
+			output += "#line 1 " + to_string(dependencies.size()) + "\n";
+			success = expand(includePath, output) && success;
+			output += "#line " + to_string(number + 1) + " " + to_string(index) + "\n";
+		}
+		return success;
+	}
+
+	const string* load(const string& path) {
+		auto file = files.find(path);
+		if (file != files.end()) {
+			return &file->second;
+		}
+
+		ifstream stream(path);
+		if (!stream) {
+			cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << path << endl;
+			return NULL;
+		}
+		stringstream code;
+		code << stream.rdbuf();
+		return &(files[path] = code.str());
+	}
+
+	// Matches: #include "file"
+	static bool parseInclude(const string& line, string& include) {
+		size_t hash = line.find_first_not_of(" \t");
+		if (hash == string::npos || line.compare(hash, 8, "#include") != 0) {
+			return false;
+		}
+		size_t open = line.find('"', hash + 8);
+		size_t close = open == string::npos ? string::npos : line.find('"', open + 1);
+		if (close == string::npos) {
+			cout << "ERROR::SHADER::INVALID_INCLUDE " << line << endl;
+			return false;
+		}
+		include = line.substr(open + 1, close - open - 1);
+		return true;
+	}
+};
+
+#endif
@@ -0,0 +1,189 @@
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <filesystem>
+
+#ifdef __linux__
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+using namespace std;
+
+// A watched shader file which was saved, together with its new source code
+struct ShaderFileChange {
+	string path;
+	string code;
+};
+
+// Watches shader files on a background thread and reads them as soon as they are saved, so the render thread
+// only has to pick up the new sources with poll() and never touches the disk.
+// On Linux the thread sleeps in inotify, elsewhere it compares the modification times a few times per second.
+// Editors often save by writing a new file and renaming it over the old one, so we watch the directories and
+// not the files themselves.
+class ShaderWatcher {
+public:
+	~ShaderWatcher() {
+		stop();
+	}
+
+	// Register the files before start(), the changes report the path exactly as it was given here.
+	// Watching a file twice has no effect.
+	void watch(const string& path) {
+		for (const WatchedFile& watched : files) {
+			if (watched.path == path) {
+				return;
+			}
+		}
+		WatchedFile file;
+		file.path = path;
+		file.directory = filesystem::path(path).parent_path().string();
+		file.name = filesystem::path(path).filename().string();
+		if (file.directory.empty()) {
+			file.directory = ".";
+		}
+		file.modified = modificationTime(path);
+		files.push_back(file);
+	}
+
+	bool start() {
+		if (running) {
+			return true;
+		}
+#ifdef __linux__
+		notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (notifyFd < 0) {
+			cout << "ERROR::SHADER_WATCHER::INOTIFY_INIT_FAILED" << endl;
+			return false;
+		}
+		for (WatchedFile& file : files) {
+			// Adding the same directory twice returns the same watch descriptor
+			file.watch = inotify_add_watch(notifyFd, file.directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+			if (file.watch < 0) {
+				cout << "ERROR::SHADER_WATCHER::NOT_WATCHABLE " << file.directory << endl;
+			}
+		}
+#endif
+		running = true;
+		worker = thread(&ShaderWatcher::run, this);
+		return true;
+	}
+
+	void stop() {
+		if (!running) {
+			return;
+		}
+		running = false;
+		worker.join();
+#ifdef __linux__
+		close(notifyFd);
+		notifyFd = -1;
+#endif
+	}
+
+	bool isRunning() const {
+		return running;
+	}
+
+	// The files saved since the last call, each file at most once with its latest contents
+	vector<ShaderFileChange> poll() {
+		vector<ShaderFileChange> result;
+		lock_guard<mutex> lock(changesMutex);
+		result.swap(changes);
+		return result;
+	}
+
+private:
+	struct WatchedFile {
+		string path;
+		string directory;
+		string name;
+		int watch = -1;
+		filesystem::file_time_type modified;
+	};
+
+	// How long the thread sleeps between two checks, this is also the time stop() may have to wait
+	static const int POLL_INTERVAL_MS = 100;
+
+	vector<WatchedFile> files;
+	thread worker;
+	atomic<bool> running{ false };
+	int notifyFd = -1;
+
+	mutex changesMutex;
+	vector<ShaderFileChange> changes;
+
+	void run() {
+		while (running) {
+#ifdef __linux__
+			pollfd descriptor = { notifyFd, POLLIN, 0 };
+			if (::poll(&descriptor, 1, POLL_INTERVAL_MS) <= 0) {
+				continue;
+			}
+
+			alignas(inotify_event) char buffer[4096];
+			ssize_t length;
+			while ((length = read(notifyFd, buffer, sizeof(buffer))) > 0) {
+				for (char* cursor = buffer; cursor < buffer + length;) {
+					const inotify_event* event = (const inotify_event*)cursor;
+					cursor += sizeof(inotify_event) + event->len;
+					if (event->len == 0) {
+						continue;
+					}
+					for (const WatchedFile& file : files) {
+						if (file.watch == event->wd && file.name == event->name) {
+							changed(file.path);
+						}
+					}
+				}
+			}
+#else
+			this_thread::sleep_for(chrono::milliseconds(POLL_INTERVAL_MS));
+			for (WatchedFile& file : files) {
+				filesystem::file_time_type modified = modificationTime(file.path);
+				if (modified != file.modified) {
+					file.modified = modified;
+					changed(file.path);
+				}
+			}
+#endif
+		}
+	}
+
+	// Reads the saved file and queues it for the render thread
+	void changed(const string& path) {
+		ifstream file(path);
+		if (!file) {
+			// Renamed away or deleted, the save which follows will be reported again
+			return;
+		}
+		stringstream code;
+		code << file.rdbuf();
+
+		lock_guard<mutex> lock(changesMutex);
+		for (ShaderFileChange& change : changes) {
+			if (change.path == path) {
+				change.code = code.str();
+				return;
+			}
+		}
+		changes.push_back({ path, code.str() });
+	}
+
+	static filesystem::file_time_type modificationTime(const string& path) {
+		error_code error;
+		return filesystem::last_write_time(path, error);
+	}
+};
+
+#endif
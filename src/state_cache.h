@@ -0,0 +1,259 @@
+#ifndef STATE_CACHE_H
+#define STATE_CACHE_H
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+using namespace std;
+
+// Keeps a copy of the GL state the render loop changes and skips every call which would set a value
+// that is already set. Each of these calls costs a trip into the driver (and often a validation of the
+// whole pipeline at the next draw), which adds up quickly with many draw calls.
+// All binds have to go through the cache, if GL is called directly call invalidate() afterwards.
+class GLStateCache {
+public:
+	static const unsigned int MAX_TEXTURE_UNITS = 16;
+
+	enum Category {
+		PROGRAM,
+		VERTEX_ARRAY,
+		BUFFER,
+		ACTIVE_TEXTURE,
+		TEXTURE,
+		BLEND,
+		DEPTH,
+		POLYGON_MODE,
+		CATEGORY_COUNT
+	};
+
+	struct Stats {
+		// Calls the application asked for
+		unsigned long long requested = 0;
+		// Calls which were skipped because the state was already set
+		unsigned long long skipped = 0;
+	};
+
+	static GLStateCache& instance() {
+		static GLStateCache cache;
+		return cache;
+	}
+
+	// Forget everything we know about the GL state, the next call of each kind always reaches GL
+	void invalidate() {
+		program = UNKNOWN;
+		vertexArray = UNKNOWN;
+		arrayBuffer = UNKNOWN;
+		activeTexture = UNKNOWN;
+		for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++) {
+			textures[unit].texture2D = UNKNOWN;
+			textures[unit].texture2DArray = UNKNOWN;
+		}
+		blend = UNKNOWN;
+		blendSource = UNKNOWN;
+		blendDestination = UNKNOWN;
+		depthTest = UNKNOWN;
+		depthFunc = UNKNOWN;
+		depthMask = UNKNOWN;
+		polygonMode = UNKNOWN;
+	}
+
+	void useProgram(unsigned int id) {
+		if (change(PROGRAM, program, id)) {
+			glUseProgram(id);
+		}
+	}
+
+	void bindVertexArray(unsigned int id) {
+		if (change(VERTEX_ARRAY, vertexArray, id)) {
+			glBindVertexArray(id);
+		}
+	}
+
+	// Only GL_ARRAY_BUFFER is cached, the element array binding belongs to the vertex array object
+	void bindBuffer(GLenum target, unsigned int id) {
+		if (target != GL_ARRAY_BUFFER) {
+			stats[BUFFER].requested++;
+			issue();
+			glBindBuffer(target, id);
+		} else if (change(BUFFER, arrayBuffer, id)) {
+			glBindBuffer(target, id);
+		}
+	}
+
+	void setActiveTexture(unsigned int unit) {
+		if (change(ACTIVE_TEXTURE, activeTexture, GL_TEXTURE0 + unit)) {
+			glActiveTexture(GL_TEXTURE0 + unit);
+		}
+	}
+
+	// Binds the texture to the given unit, the active texture unit is only switched if the bind is needed.
+	// Every target of a unit is a binding point of its own, a 2D texture and an array on unit 0 don't replace each other.
+	void bindTexture(unsigned int unit, GLenum target, unsigned int id) {
+		stats[TEXTURE].requested++;
+		unsigned int* cached = textureBinding(unit, target);
+		if (cached != NULL && *cached == id) {
+			stats[TEXTURE].skipped++;
+			return;
+		}
+		setActiveTexture(unit);
+		glBindTexture(target, id);
+		issue();
+		if (cached != NULL) {
+			*cached = id;
+		}
+	}
+
+	// Call after deleting a texture. GL hands its id out again, and a bind of the new texture must not be skipped
+	// because the cache still remembers the old one on a unit.
+	void forgetTexture(unsigned int id) {
+		for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++) {
+			if (textures[unit].texture2D == id) {
+				textures[unit].texture2D = UNKNOWN;
+			}
+			if (textures[unit].texture2DArray == id) {
+				textures[unit].texture2DArray = UNKNOWN;
+			}
+		}
+	}
+
+	void setBlend(bool enabled) {
+		if (change(BLEND, blend, enabled)) {
+			if (enabled) {
+				glEnable(GL_BLEND);
+			} else {
+				glDisable(GL_BLEND);
+			}
+		}
+	}
+
+	void setBlendFunc(GLenum source, GLenum destination) {
+		stats[BLEND].requested++;
+		if (blendSource == source && blendDestination == destination) {
+			stats[BLEND].skipped++;
+			return;
+		}
+		blendSource = source;
+		blendDestination = destination;
+		issue();
+		glBlendFunc(source, destination);
+	}
+
+	void setDepthTest(bool enabled) {
+		if (change(DEPTH, depthTest, enabled)) {
+			if (enabled) {
+				glEnable(GL_DEPTH_TEST);
+			} else {
+				glDisable(GL_DEPTH_TEST);
+			}
+		}
+	}
+
+	void setDepthFunc(GLenum func) {
+		if (change(DEPTH, depthFunc, func)) {
+			glDepthFunc(func);
+		}
+	}
+
+	void setDepthMask(bool write) {
+		if (change(DEPTH, depthMask, write)) {
+			glDepthMask(write ? GL_TRUE : GL_FALSE);
+		}
+	}
+
+	// Applies to GL_FRONT_AND_BACK, the only face core profile allows
+	void setPolygonMode(GLenum mode) {
+		if (change(POLYGON_MODE, polygonMode, mode)) {
+			glPolygonMode(GL_FRONT_AND_BACK, mode);
+		}
+	}
+
+	// State calls which actually reached GL since the last endFrame()
+	unsigned int frameIssued() const {
+		return issued;
+	}
+
+	void endFrame() {
+		issued = 0;
+	}
+
+	const Stats& categoryStats(Category category) const {
+		return stats[category];
+	}
+
+	static const char* categoryName(Category category) {
+		static const char* names[CATEGORY_COUNT] = { "program", "vertexArray", "buffer", "activeTexture", "texture", "blend", "depth", "polygonMode" };
+		return names[category];
+	}
+
+	void printStats() const {
+		cout << "State cache skip rates:" << endl;
+		for (unsigned int i = 0; i < CATEGORY_COUNT; i++) {
+			if (stats[i].requested > 0) {
+				cout << "  " << categoryName((Category)i) << ": " << stats[i].skipped << " of " << stats[i].requested
+					<< " skipped (" << 100.0 * stats[i].skipped / stats[i].requested << "%)" << endl;
+			}
+		}
+	}
+
+private:
+	static const unsigned int UNKNOWN = 0xFFFFFFFF;
+
+	// the targets the application uses, others are always bound
+	struct TextureUnit {
+		unsigned int texture2D;
+		unsigned int texture2DArray;
+	};
+
+	unsigned int program;
+	unsigned int vertexArray;
+	unsigned int arrayBuffer;
+	unsigned int activeTexture;
+	TextureUnit textures[MAX_TEXTURE_UNITS];
+	unsigned int blend;
+	unsigned int blendSource;
+	unsigned int blendDestination;
+	unsigned int depthTest;
+	unsigned int depthFunc;
+	unsigned int depthMask;
+	unsigned int polygonMode;
+
+	Stats stats[CATEGORY_COUNT];
+	unsigned int issued = 0;
+
+	GLStateCache() {
+		invalidate();
+	}
+
+	unsigned int* textureBinding(unsigned int unit, GLenum target) {
+		if (unit >= MAX_TEXTURE_UNITS) {
+			return NULL;
+		}
+		switch (target) {
+			case GL_TEXTURE_2D:
+				return &textures[unit].texture2D;
+			case GL_TEXTURE_2D_ARRAY:
+				return &textures[unit].texture2DArray;
+			default:
+				return NULL;
+		}
+	}
+
+	// Updates the cached value and returns true if GL has to be called
+	bool change(Category category, unsigned int& cached, unsigned int value) {
+		stats[category].requested++;
+		if (cached == value) {
+			stats[category].skipped++;
+			return false;
+		}
+		cached = value;
+		issue();
+		return true;
+	}
+
+	void issue() {
+		issued++;
+	}
+};
+
+#endif
@@ -0,0 +1,265 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <filesystem>
+
+#include "profiler.h"
+#include "mapped_file.h"
+#include "texture_compressor.h"
+
+using namespace std;
+
+// Enough for a 32768 x 32768 texture
+const unsigned int MAX_TEXTURE_LEVELS = 16;
+
+// One mip level, offset is relative to the first level
+struct TextureLevel {
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint64_t offset = 0;
+	uint64_t size = 0;
+};
+
+// A texture with all of its mip levels, ready for glTexImage2D or glCompressedTexImage2D. From the cache the pixels
+// point into the mapped file; while baking they point into storage.
+struct BakedTexture {
+	// the TextureLoader hash of the decoded image
+	uint64_t contentHash = 0;
+	GLint internalFormat = 0;
+	// the format of the image's channels, GL_RGB or GL_RGBA, also if the levels are compressed
+	GLenum format = 0;
+	// GL_NONE if the levels are compressed blocks of internalFormat
+	GLenum type = 0;
+	unsigned int levelCount = 0;
+	TextureLevel levels[MAX_TEXTURE_LEVELS];
+	// all levels one after another, each row tightly packed or each level a sequence of blocks
+	const unsigned char* pixels = NULL;
+	size_t pixelBytes = 0;
+
+	MappedFile file;
+	vector<unsigned char> storage;
+};
+
+// Keeps textures with their full mip chain in cache/textures, so an image is only decoded and its mips are only
+// generated the first time it is used. Afterwards the file is memory mapped and the levels are uploaded as they are.
+// A cache file is a fixed size header followed by the levels, largest first, starting 64 bytes aligned:
+//
+//	Header | level 0 | level 1 | ... | level n
+//
+// The header stores the GL formats, the size and offset of every level, a version and a key built from the source
+// file's path, size and modification time and the loader's settings. Editing the image, changing the compression
+// or the file layout results in a miss.
+// map() and store() may be called from several threads at the same time.
+class TextureCache {
+public:
+	static TextureCache& instance() {
+		static TextureCache cache;
+		return cache;
+	}
+
+	// Maps the cached texture of the source image, false on a miss
+	bool map(const string& sourcePath, uint64_t settings, BakedTexture& texture) {
+		PROFILE_ZONE("MapCachedTexture");
+		if (rebuild || !mapFile(key(sourcePath, settings), texture)) {
+			misses++;
+			return false;
+		}
+		hits++;
+		return true;
+	}
+
+	// Writes the texture into the cache
+	bool store(const string& sourcePath, uint64_t settings, const BakedTexture& texture) {
+		PROFILE_ZONE("StoreCachedTexture");
+		if (texture.levelCount == 0 || texture.levelCount > MAX_TEXTURE_LEVELS) {
+			return false;
+		}
+		Header header;
+		header.magic = MAGIC;
+		header.version = VERSION;
+		header.key = key(sourcePath, settings);
+		header.contentHash = texture.contentHash;
+		header.internalFormat = (uint32_t)texture.internalFormat;
+		header.format = texture.format;
+		header.type = texture.type;
+		header.levelCount = texture.levelCount;
+		memcpy(header.levels, texture.levels, sizeof(header.levels));
+		header.dataOffset = align(sizeof(Header));
+		header.dataSize = texture.pixelBytes;
+
+		error_code error;
+		filesystem::create_directories(directory, error);
+		// write under a name of our own and rename, so a half written file is never mistaken for a complete one
+		string cachePath = path(header.key);
+		string temporaryPath = uniqueTemporaryPath(cachePath);
+		{
+			ofstream file(temporaryPath, ios::binary | ios::trunc);
+			if (!file) {
+				cout << "ERROR::TEXTURE_CACHE::NOT_WRITABLE " << temporaryPath << endl;
+				return false;
+			}
+			const char padding[ALIGNMENT] = {};
+			file.write((const char*)&header, sizeof(header));
+			file.write(padding, header.dataOffset - sizeof(header));
+			file.write((const char*)texture.pixels, texture.pixelBytes);
+			if (!file) {
+				cout << "ERROR::TEXTURE_CACHE::WRITE_FAILED " << temporaryPath << endl;
+				return false;
+			}
+		}
+		filesystem::rename(temporaryPath, cachePath, error);
+		if (error) {
+			cout << "ERROR::TEXTURE_CACHE::NOT_WRITABLE " << cachePath << endl;
+			filesystem::remove(temporaryPath, error);
+			return false;
+		}
+		return true;
+	}
+
+	// Identifies the cached texture, settings covers anything else the baked levels depend on
+	uint64_t key(const string& sourcePath, uint64_t settings) const {
+		error_code error;
+		filesystem::path source = filesystem::absolute(sourcePath, error).lexically_normal();
+		uint64_t hash = FNV_OFFSET;
+		hash = fnv1a(hash, source.generic_string());
+		hash = fnv1a(hash, to_string(filesystem::file_size(source, error)));
+		hash = fnv1a(hash, to_string(filesystem::last_write_time(source, error).time_since_epoch().count()));
+		hash = fnv1a(hash, to_string(settings));
+		return hash;
+	}
+
+	// Where the textures are stored, relative to the working directory
+	string directory = "cache/textures";
+	// Ignore the cached textures and bake them again, set it before loading textures
+	bool rebuild = false;
+
+	atomic<unsigned int> hits{ 0 };
+	atomic<unsigned int> misses{ 0 };
+
+private:
+	static const uint32_t MAGIC = 0x5854474C; // "LGTX"
+	// Increase whenever the file layout or the way the levels are made changes
+	static const uint32_t VERSION = 4;
+	static const size_t ALIGNMENT = 64;
+	static const uint64_t FNV_OFFSET = 14695981039346656037ull;
+	static const uint64_t FNV_PRIME = 1099511628211ull;
+
+	struct Header {
+		uint32_t magic = 0;
+		uint32_t version = 0;
+		uint64_t key = 0;
+		uint64_t contentHash = 0;
+		uint32_t internalFormat = 0;
+		uint32_t format = 0;
+		uint32_t type = 0;
+		uint32_t levelCount = 0;
+		TextureLevel levels[MAX_TEXTURE_LEVELS];
+		uint64_t dataOffset = 0;
+		uint64_t dataSize = 0;
+	};
+
+	// The largest level 0 which still fits into MAX_TEXTURE_LEVELS levels
+	static const uint32_t MAX_TEXTURE_SIZE = 1u << (MAX_TEXTURE_LEVELS - 1);
+
+	// Bytes of a level in the formats of the header, 0 for formats the loader never bakes
+	static uint64_t levelSize(const Header& header, uint32_t width, uint32_t height) {
+		if (header.type == GL_NONE) {
+			switch (header.internalFormat) {
+				case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+				case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+				case GL_COMPRESSED_RGBA_BPTC_UNORM_ARB:
+					return TextureCompressor::compressedSize(header.internalFormat, width, height);
+				default:
+					return 0;
+			}
+		}
+		if (header.type != GL_UNSIGNED_BYTE) {
+			return 0;
+		}
+		switch (header.format) {
+			case GL_RED:
+				return (uint64_t)width * height;
+			case GL_RGB:
+				return (uint64_t)width * height * 3;
+			case GL_RGBA:
+				return (uint64_t)width * height * 4;
+			default:
+				return 0;
+		}
+	}
+
+	static size_t align(size_t offset) {
+		return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+	}
+
+	bool mapFile(uint64_t key, BakedTexture& texture) {
+		string cachePath = path(key);
+		error_code error;
+		if (!filesystem::exists(cachePath, error)) {
+			return false;
+		}
+		if (!texture.file.open(cachePath) || texture.file.size() < sizeof(Header)) {
+			texture.file.close();
+			return false;
+		}
+
+		Header header;
+		memcpy(&header, texture.file.data(), sizeof(header));
+		bool valid = header.magic == MAGIC && header.version == VERSION && header.key == key
+			&& header.levelCount > 0 && header.levelCount <= MAX_TEXTURE_LEVELS
+			&& header.dataOffset % ALIGNMENT == 0 && header.dataOffset + header.dataSize <= texture.file.size();
+		// the levels must be the chain the loader bakes, so the upload never reads past a level or the file
+		const TextureLevel* levels = header.levels;
+		valid = valid && levels[0].width > 0 && levels[0].height > 0
+			&& levels[0].width <= MAX_TEXTURE_SIZE && levels[0].height <= MAX_TEXTURE_SIZE;
+		for (unsigned int level = 0; valid && level < header.levelCount; level++) {
+			valid = levels[level].size == levelSize(header, levels[level].width, levels[level].height)
+				&& levels[level].size > 0
+				&& levels[level].offset <= header.dataSize && levels[level].size <= header.dataSize - levels[level].offset;
+			if (valid && level > 0) {
+				valid = levels[level].width == max(levels[level - 1].width / 2, 1u)
+					&& levels[level].height == max(levels[level - 1].height / 2, 1u);
+			}
+		}
+		if (!valid) {
+			texture.file.close();
+			return false;
+		}
+
+		texture.contentHash = header.contentHash;
+		texture.internalFormat = (GLint)header.internalFormat;
+		texture.format = header.format;
+		texture.type = header.type;
+		texture.levelCount = header.levelCount;
+		memcpy(texture.levels, header.levels, sizeof(header.levels));
+		texture.pixels = texture.file.data() + header.dataOffset;
+		texture.pixelBytes = (size_t)header.dataSize;
+		return true;
+	}
+
+	static uint64_t fnv1a(uint64_t hash, const string& text) {
+		for (unsigned char c : text) {
+			hash = (hash ^ c) * FNV_PRIME;
+		}
+		// Separate the strings so "ab" + "c" and "a" + "bc" don't collide
+		return (hash ^ 0xFF) * FNV_PRIME;
+	}
+
+	string path(uint64_t key) const {
+		stringstream name;
+		name << directory << "/" << hex << key << ".tex";
+		return name.str();
+	}
+};
+
+#endif
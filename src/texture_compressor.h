@@ -0,0 +1,665 @@
+#ifndef TEXTURE_COMPRESSOR_H
+#define TEXTURE_COMPRESSOR_H
+
+#include <glad/glad.h>
+
+#include <cmath>
+#include <cfloat>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include "profiler.h"
+#include "thread_pool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXTURE_COMPRESSOR_SSE
+#endif
+
+using namespace std;
+
+// How hard the TextureCompressor tries, more tries give a higher PSNR and take longer
+enum TextureCompression {
+	// upload the images uncompressed
+	TEXTURE_COMPRESSION_OFF,
+	// endpoints from the bounding box, no refinement
+	TEXTURE_COMPRESSION_FAST,
+	// endpoints along the principal axis, refined once
+	TEXTURE_COMPRESSION_NORMAL,
+	// endpoints along the principal axis, refined three times
+	TEXTURE_COMPRESSION_BEST
+};
+
+// Compresses RGB(A) images into the block formats GPUs sample directly, 4x4 pixels per block:
+//  - BC1 (S3TC DXT1) for opaque images, 8 bytes per block: two RGB565 endpoints and a 2 bit index per pixel
+//    into the endpoints and the two colors between them
+//  - BC3 (S3TC DXT5) for images with alpha, 16 bytes: a BC1 block for the colors and an alpha block with two
+//    8 bit endpoints and a 3 bit index per pixel
+//  - BC7 (BPTC) for images with alpha, 16 bytes. Only mode 6 is written: one pair of RGBA endpoints with 7 bits
+//    per channel plus a shared lowest bit each, and a 4 bit index per pixel. It has far less error than BC3 on
+//    smooth alpha and is simple enough to search quickly; the partitioned modes would win on blocks with
+//    several distinct colors.
+// Every block is encoded the same way: pick two endpoints, quantize them, pick the closest palette entry for every
+// pixel and refine the endpoints by least squares for those indices. The palette search runs on four pixels at a
+// time with SSE2 and the blocks are spread across the thread pool.
+namespace TextureCompressor {
+	// 4x4 pixels as structure of arrays, channel values from 0 to 255
+	struct Block {
+		alignas(16) float channels[4][16];
+	};
+
+	// Position of the indices of BC7 mode 6 endpoints, 0 is the first endpoint and 64 the second one
+	const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// The compressed format for an image with this many channels, GL_NONE if the context supports none
+	inline GLenum chooseFormat(int channels) {
+		if (channels == 3) {
+			if (GLAD_GL_EXT_texture_compression_s3tc) {
+				return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+			}
+			if (GLAD_GL_ARB_texture_compression_bptc) {
+				return GL_COMPRESSED_RGBA_BPTC_UNORM_ARB;
+			}
+		} else if (channels == 4) {
+			if (GLAD_GL_ARB_texture_compression_bptc) {
+				return GL_COMPRESSED_RGBA_BPTC_UNORM_ARB;
+			}
+			if (GLAD_GL_EXT_texture_compression_s3tc) {
+				return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+			}
+		}
+		return GL_NONE;
+	}
+
+	inline const char* formatName(GLenum format) {
+		switch (format) {
+			case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+				return "BC1";
+			case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+				return "BC3";
+			case GL_COMPRESSED_RGBA_BPTC_UNORM_ARB:
+				return "BC7";
+			default:
+				return "uncompressed";
+		}
+	}
+
+	inline size_t blockSize(GLenum format) {
+		return format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 8 : 16;
+	}
+
+	// Bytes of an image of this size in the format, partial blocks at the borders count as whole ones
+	inline size_t compressedSize(GLenum format, unsigned int width, unsigned int height) {
+		return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockSize(format);
+	}
+
+	// Reads the block at blockX, blockY. Blocks reaching over the border repeat the last row and column,
+	// so the padding doesn't pull the endpoints away from the visible pixels.
+	inline void loadBlock(const unsigned char* pixels, unsigned int width, unsigned int height, int channels, unsigned int blockX, unsigned int blockY, Block& block) {
+		for (unsigned int y = 0; y < 4; y++) {
+			unsigned int row = min(blockY * 4 + y, height - 1);
+			for (unsigned int x = 0; x < 4; x++) {
+				unsigned int column = min(blockX * 4 + x, width - 1);
+				const unsigned char* pixel = pixels + ((size_t)row * width + column) * channels;
+				for (int c = 0; c < 4; c++) {
+					block.channels[c][y * 4 + x] = c < channels ? pixel[c] : 255.0f;
+				}
+			}
+		}
+	}
+
+	// Picks the palette entry closest to every pixel, only the channels first to first + count - 1 count.
+	// Returns the summed squared error.
+	inline float selectIndices(const Block& block, const float (*palette)[4], int paletteSize, int first, int count, uint8_t* indices) {
+		float error = 0.0f;
+#ifdef TEXTURE_COMPRESSOR_SSE
+		for (int group = 0; group < 16; group += 4) {
+			__m128 pixels[4];
+			for (int c = first; c < first + count; c++) {
+				pixels[c] = _mm_load_ps(&block.channels[c][group]);
+			}
+			__m128 best = _mm_set1_ps(FLT_MAX);
+			__m128i bestIndex = _mm_setzero_si128();
+			for (int entry = 0; entry < paletteSize; entry++) {
+				__m128 distance = _mm_setzero_ps();
+				for (int c = first; c < first + count; c++) {
+					__m128 difference = _mm_sub_ps(pixels[c], _mm_set1_ps(palette[entry][c]));
+					distance = _mm_add_ps(distance, _mm_mul_ps(difference, difference));
+				}
+				// there is no blend in SSE2, select the closer index with masks
+				__m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+				bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(entry)), _mm_andnot_si128(closer, bestIndex));
+				best = _mm_min_ps(distance, best);
+			}
+			alignas(16) int32_t groupIndices[4];
+			alignas(16) float groupErrors[4];
+			_mm_store_si128((__m128i*)groupIndices, bestIndex);
+			_mm_store_ps(groupErrors, best);
+			for (int i = 0; i < 4; i++) {
+				indices[group + i] = (uint8_t)groupIndices[i];
+				error += groupErrors[i];
+			}
+		}
+#else
+		for (int i = 0; i < 16; i++) {
+			float best = FLT_MAX;
+			for (int entry = 0; entry < paletteSize; entry++) {
+				float distance = 0.0f;
+				for (int c = first; c < first + count; c++) {
+					float difference = block.channels[c][i] - palette[entry][c];
+					distance += difference * difference;
+				}
+				if (distance < best) {
+					best = distance;
+					indices[i] = (uint8_t)entry;
+				}
+			}
+			error += best;
+		}
+#endif
+		return error;
+	}
+
+	// Endpoints at both ends of the pixels along the direction they vary most in. FAST takes the diagonal of the
+	// bounding box (turned by the signs of the covariance), the others find the principal axis by power iteration.
+	inline void findEndpoints(const Block& block, int first, int count, TextureCompression quality, float* low, float* high) {
+		float mean[4] = {};
+		float minimum[4], maximum[4];
+		for (int c = first; c < first + count; c++) {
+			minimum[c] = 255.0f;
+			maximum[c] = 0.0f;
+			for (int i = 0; i < 16; i++) {
+				mean[c] += block.channels[c][i];
+				minimum[c] = min(minimum[c], block.channels[c][i]);
+				maximum[c] = max(maximum[c], block.channels[c][i]);
+			}
+			mean[c] /= 16.0f;
+		}
+
+		float covariance[4][4] = {};
+		for (int i = 0; i < 16; i++) {
+			for (int a = first; a < first + count; a++) {
+				for (int b = a; b < first + count; b++) {
+					covariance[a][b] += (block.channels[a][i] - mean[a]) * (block.channels[b][i] - mean[b]);
+				}
+			}
+		}
+
+		// the channel with the widest range sets the direction of the others
+		int widest = first;
+		for (int c = first; c < first + count; c++) {
+			if (maximum[c] - minimum[c] > maximum[widest] - minimum[widest]) {
+				widest = c;
+			}
+		}
+		float axis[4] = {};
+		for (int c = first; c < first + count; c++) {
+			float together = c < widest ? covariance[c][widest] : covariance[widest][c];
+			axis[c] = (maximum[c] - minimum[c]) * (together < 0.0f ? -1.0f : 1.0f);
+		}
+
+		if (quality != TEXTURE_COMPRESSION_FAST) {
+			for (int iteration = 0; iteration < 8; iteration++) {
+				float next[4] = {};
+				float length = 0.0f;
+				for (int a = first; a < first + count; a++) {
+					for (int b = first; b < first + count; b++) {
+						next[a] += (a <= b ? covariance[a][b] : covariance[b][a]) * axis[b];
+					}
+					length = max(length, fabs(next[a]));
+				}
+				if (length == 0.0f) {
+					break;
+				}
+				for (int c = first; c < first + count; c++) {
+					axis[c] = next[c] / length;
+				}
+			}
+		}
+
+		float lengthSquared = 0.0f;
+		for (int c = first; c < first + count; c++) {
+			lengthSquared += axis[c] * axis[c];
+		}
+		if (lengthSquared == 0.0f) {
+			// all pixels are the same
+			for (int c = first; c < first + count; c++) {
+				low[c] = high[c] = mean[c];
+			}
+			return;
+		}
+
+		float lowest = FLT_MAX, highest = -FLT_MAX;
+		for (int i = 0; i < 16; i++) {
+			float t = 0.0f;
+			for (int c = first; c < first + count; c++) {
+				t += (block.channels[c][i] - mean[c]) * axis[c];
+			}
+			lowest = min(lowest, t);
+			highest = max(highest, t);
+		}
+		for (int c = first; c < first + count; c++) {
+			low[c] = min(max(mean[c] + axis[c] * lowest / lengthSquared, 0.0f), 255.0f);
+			high[c] = min(max(mean[c] + axis[c] * highest / lengthSquared, 0.0f), 255.0f);
+		}
+	}
+
+	// The endpoints which minimize the squared error if pixel i sits at weights[indices[i]] between them
+	inline void refineEndpoints(const Block& block, int first, int count, const uint8_t* indices, const float* weights, float* low, float* high) {
+		float lowLow = 0.0f, highHigh = 0.0f, lowHigh = 0.0f;
+		float lowPixels[4] = {}, highPixels[4] = {};
+		for (int i = 0; i < 16; i++) {
+			float t = weights[indices[i]];
+			float s = 1.0f - t;
+			lowLow += s * s;
+			highHigh += t * t;
+			lowHigh += s * t;
+			for (int c = first; c < first + count; c++) {
+				lowPixels[c] += s * block.channels[c][i];
+				highPixels[c] += t * block.channels[c][i];
+			}
+		}
+		float determinant = lowLow * highHigh - lowHigh * lowHigh;
+		if (fabs(determinant) < 1e-6f) {
+			// all pixels use the same index
+			return;
+		}
+		for (int c = first; c < first + count; c++) {
+			low[c] = min(max((lowPixels[c] * highHigh - highPixels[c] * lowHigh) / determinant, 0.0f), 255.0f);
+			high[c] = min(max((highPixels[c] * lowLow - lowPixels[c] * lowHigh) / determinant, 0.0f), 255.0f);
+		}
+	}
+
+	inline int refinements(TextureCompression quality) {
+		return quality == TEXTURE_COMPRESSION_BEST ? 3 : quality == TEXTURE_COMPRESSION_NORMAL ? 1 : 0;
+	}
+
+	inline uint16_t packRgb565(const float* color) {
+		unsigned int r = (unsigned int)(color[0] * 31.0f / 255.0f + 0.5f);
+		unsigned int g = (unsigned int)(color[1] * 63.0f / 255.0f + 0.5f);
+		unsigned int b = (unsigned int)(color[2] * 31.0f / 255.0f + 0.5f);
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	inline void unpackRgb565(uint16_t packed, int* color) {
+		int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	// The four colors of a BC1 block in four color mode
+	inline void bc1Palette(uint16_t color0, uint16_t color1, int (*palette)[4]) {
+		unpackRgb565(color0, palette[0]);
+		unpackRgb565(color1, palette[1]);
+		for (int c = 0; c < 3; c++) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		for (int entry = 0; entry < 4; entry++) {
+			palette[entry][3] = 255;
+		}
+	}
+
+	inline void encodeBc1(const Block& block, TextureCompression quality, unsigned char* output) {
+		// index 2 and 3 sit a third and two thirds of the way from the first endpoint to the second
+		const float WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		float first[4], second[4];
+		findEndpoints(block, 0, 3, quality, first, second);
+
+		float bestError = FLT_MAX;
+		uint16_t bestColors[2] = {};
+		uint8_t bestIndices[16] = {};
+		for (int iteration = 0; iteration <= refinements(quality); iteration++) {
+			// the first endpoint is the larger one, so the block is decoded in four color mode
+			uint16_t colors[2] = { packRgb565(first), packRgb565(second) };
+			if (colors[0] < colors[1]) {
+				swap(colors[0], colors[1]);
+				swap_ranges(first, first + 3, second);
+			}
+			int entries[4][4];
+			bc1Palette(colors[0], colors[1], entries);
+			float palette[4][4];
+			for (int entry = 0; entry < 4; entry++) {
+				for (int c = 0; c < 4; c++) {
+					palette[entry][c] = (float)entries[entry][c];
+				}
+			}
+			uint8_t indices[16];
+			float error = selectIndices(block, palette, colors[0] == colors[1] ? 1 : 4, 0, 3, indices);
+			if (error < bestError) {
+				bestError = error;
+				bestColors[0] = colors[0];
+				bestColors[1] = colors[1];
+				memcpy(bestIndices, indices, sizeof(indices));
+			}
+			if (error == 0.0f) {
+				break;
+			}
+			refineEndpoints(block, 0, 3, indices, WEIGHTS, first, second);
+		}
+
+		uint32_t bits = 0;
+		for (int i = 0; i < 16; i++) {
+			bits |= (uint32_t)bestIndices[i] << (i * 2);
+		}
+		output[0] = (unsigned char)(bestColors[0] & 0xFF);
+		output[1] = (unsigned char)(bestColors[0] >> 8);
+		output[2] = (unsigned char)(bestColors[1] & 0xFF);
+		output[3] = (unsigned char)(bestColors[1] >> 8);
+		memcpy(output + 4, &bits, 4);
+	}
+
+	// The eight values of a BC3 alpha block. If the first endpoint is larger the six values between them are
+	// interpolated, otherwise four are and the last two are 0 and 255.
+	inline void alphaPalette(int alpha0, int alpha1, int* palette) {
+		palette[0] = alpha0;
+		palette[1] = alpha1;
+		if (alpha0 > alpha1) {
+			for (int k = 2; k < 8; k++) {
+				palette[k] = ((8 - k) * alpha0 + (k - 1) * alpha1) / 7;
+			}
+		} else {
+			for (int k = 2; k < 6; k++) {
+				palette[k] = ((6 - k) * alpha0 + (k - 1) * alpha1) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	inline void encodeAlpha(const Block& block, unsigned char* output) {
+		int minimum = 255, maximum = 0;
+		// without the values 0 and 255, which the six value mode has anyway
+		int innerMinimum = 255, innerMaximum = 0;
+		for (int i = 0; i < 16; i++) {
+			int alpha = (int)block.channels[3][i];
+			minimum = min(minimum, alpha);
+			maximum = max(maximum, alpha);
+			if (alpha != 0 && alpha != 255) {
+				innerMinimum = min(innerMinimum, alpha);
+				innerMaximum = max(innerMaximum, alpha);
+			}
+		}
+		if (innerMinimum > innerMaximum) {
+			innerMinimum = innerMaximum = 0;
+		}
+
+		// cutouts like grass.png are mostly 0 and 255 and fit the six value mode, soft edges the eight value one
+		int candidates[2][2] = { { maximum, minimum }, { innerMinimum, innerMaximum } };
+		float bestError = FLT_MAX;
+		uint8_t bestIndices[16] = {};
+		int best = 0;
+		for (int candidate = 0; candidate < 2; candidate++) {
+			int values[8];
+			alphaPalette(candidates[candidate][0], candidates[candidate][1], values);
+			float palette[8][4] = {};
+			for (int entry = 0; entry < 8; entry++) {
+				palette[entry][3] = (float)values[entry];
+			}
+			uint8_t indices[16];
+			float error = selectIndices(block, palette, 8, 3, 1, indices);
+			if (error < bestError) {
+				bestError = error;
+				best = candidate;
+				memcpy(bestIndices, indices, sizeof(indices));
+			}
+		}
+
+		output[0] = (unsigned char)candidates[best][0];
+		output[1] = (unsigned char)candidates[best][1];
+		uint64_t bits = 0;
+		for (int i = 0; i < 16; i++) {
+			bits |= (uint64_t)bestIndices[i] << (i * 3);
+		}
+		for (int i = 0; i < 6; i++) {
+			output[2 + i] = (unsigned char)(bits >> (i * 8));
+		}
+	}
+
+	inline void encodeBc3(const Block& block, TextureCompression quality, unsigned char* output) {
+		encodeAlpha(block, output);
+		encodeBc1(block, quality, output + 8);
+	}
+
+	// Writes the bits of a BC7 block from the lowest one up
+	struct BitWriter {
+		uint64_t bits[2] = {};
+		unsigned int position = 0;
+
+		void write(uint32_t value, unsigned int count) {
+			if (position < 64) {
+				bits[0] |= (uint64_t)value << position;
+				if (position + count > 64) {
+					bits[1] |= (uint64_t)value >> (64 - position);
+				}
+			} else {
+				bits[1] |= (uint64_t)value << (position - 64);
+			}
+			position += count;
+		}
+	};
+
+	struct BitReader {
+		uint64_t bits[2] = {};
+		unsigned int position = 0;
+
+		uint32_t read(unsigned int count) {
+			uint32_t value = 0;
+			for (unsigned int i = 0; i < count; i++, position++) {
+				value |= (uint32_t)((bits[position / 64] >> (position % 64)) & 1) << i;
+			}
+			return value;
+		}
+	};
+
+	// The 7 bit value which, with the lowest bit shared, comes closest to value
+	inline int quantizeBc7(float value, int sharedBit) {
+		int quantized = (int)floor((value - sharedBit) / 2.0f + 0.5f);
+		return min(max(quantized, 0), 127);
+	}
+
+	// The shared lowest bit which brings the quantized endpoint closest to the original one
+	inline int closestSharedBit(const float* endpoint) {
+		float errors[2] = {};
+		for (int sharedBit = 0; sharedBit < 2; sharedBit++) {
+			for (int c = 0; c < 4; c++) {
+				float difference = endpoint[c] - (quantizeBc7(endpoint[c], sharedBit) * 2 + sharedBit);
+				errors[sharedBit] += difference * difference;
+			}
+		}
+		return errors[1] < errors[0] ? 1 : 0;
+	}
+
+	inline void encodeBc7(const Block& block, TextureCompression quality, unsigned char* output) {
+		float weights[16];
+		for (int i = 0; i < 16; i++) {
+			weights[i] = BC7_WEIGHTS[i] / 64.0f;
+		}
+		float low[4], high[4];
+		findEndpoints(block, 0, 4, quality, low, high);
+
+		float bestError = FLT_MAX;
+		int bestEndpoints[2][4] = {};
+		int bestSharedBits[2] = {};
+		uint8_t bestIndices[16] = {};
+		for (int iteration = 0; iteration <= refinements(quality); iteration++) {
+			// FAST only tries the shared bits closest to the endpoints, the others try all four combinations
+			int firstCombination = 0, lastCombination = 3;
+			if (quality == TEXTURE_COMPRESSION_FAST) {
+				firstCombination = lastCombination = closestSharedBit(low) | (closestSharedBit(high) << 1);
+			}
+			uint8_t iterationIndices[16] = {};
+			float iterationError = FLT_MAX;
+			for (int combination = firstCombination; combination <= lastCombination; combination++) {
+				int sharedBits[2] = { combination & 1, combination >> 1 };
+				int endpoints[2][4];
+				for (int c = 0; c < 4; c++) {
+					endpoints[0][c] = quantizeBc7(low[c], sharedBits[0]);
+					endpoints[1][c] = quantizeBc7(high[c], sharedBits[1]);
+				}
+				float palette[16][4];
+				for (int entry = 0; entry < 16; entry++) {
+					for (int c = 0; c < 4; c++) {
+						int value0 = endpoints[0][c] * 2 + sharedBits[0];
+						int value1 = endpoints[1][c] * 2 + sharedBits[1];
+						palette[entry][c] = (float)(((64 - BC7_WEIGHTS[entry]) * value0 + BC7_WEIGHTS[entry] * value1 + 32) >> 6);
+					}
+				}
+				uint8_t indices[16];
+				float error = selectIndices(block, palette, 16, 0, 4, indices);
+				if (error < iterationError) {
+					iterationError = error;
+					memcpy(iterationIndices, indices, sizeof(indices));
+				}
+				if (error < bestError) {
+					bestError = error;
+					memcpy(bestEndpoints, endpoints, sizeof(endpoints));
+					memcpy(bestSharedBits, sharedBits, sizeof(sharedBits));
+					memcpy(bestIndices, indices, sizeof(indices));
+				}
+			}
+			if (bestError == 0.0f) {
+				break;
+			}
+			refineEndpoints(block, 0, 4, iterationIndices, weights, low, high);
+		}
+
+		// The highest bit of the first pixel's index is left out and has to be 0, swap the endpoints if it isn't
+		if (bestIndices[0] >= 8) {
+			for (int c = 0; c < 4; c++) {
+				swap(bestEndpoints[0][c], bestEndpoints[1][c]);
+			}
+			swap(bestSharedBits[0], bestSharedBits[1]);
+			for (int i = 0; i < 16; i++) {
+				bestIndices[i] = 15 - bestIndices[i];
+			}
+		}
+
+		BitWriter writer;
+		// mode 6 is a 1 after six 0 bits
+		writer.write(1 << 6, 7);
+		for (int c = 0; c < 4; c++) {
+			writer.write(bestEndpoints[0][c], 7);
+			writer.write(bestEndpoints[1][c], 7);
+		}
+		writer.write(bestSharedBits[0], 1);
+		writer.write(bestSharedBits[1], 1);
+		writer.write(bestIndices[0], 3);
+		for (int i = 1; i < 16; i++) {
+			writer.write(bestIndices[i], 4);
+		}
+		memcpy(output, writer.bits, 16);
+	}
+
+	// Compresses an image with 3 or 4 channels into blocks, which has to hold compressedSize(format, ...) bytes.
+	// The block rows are spread across the pool with parallelFor, so it may also be called from a job of the pool
+	// (the TextureLoader's decode job does), the calling thread compresses rows itself while it waits.
+	inline void compress(const unsigned char* pixels, unsigned int width, unsigned int height, int channels, GLenum format, TextureCompression quality, unsigned char* blocks, ThreadPool& pool = ThreadPool::shared()) {
+		PROFILE_ZONE("CompressTexture");
+		unsigned int blocksX = (width + 3) / 4;
+		unsigned int blocksY = (height + 3) / 4;
+		size_t size = blockSize(format);
+		pool.parallelFor(blocksY, [&](size_t begin, size_t end) {
+			Block block;
+			for (size_t blockY = begin; blockY < end; blockY++) {
+				for (unsigned int blockX = 0; blockX < blocksX; blockX++) {
+					loadBlock(pixels, width, height, channels, blockX, (unsigned int)blockY, block);
+					unsigned char* output = blocks + (blockY * blocksX + blockX) * size;
+					switch (format) {
+						case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+							encodeBc1(block, quality, output);
+							break;
+						case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+							encodeBc3(block, quality, output);
+							break;
+						default:
+							encodeBc7(block, quality, output);
+							break;
+					}
+				}
+			}
+		});
+	}
+
+	// Decodes one block into 16 RGBA pixels, only the formats compress() writes
+	inline void decodeBlock(const unsigned char* input, GLenum format, unsigned char (*pixels)[4]) {
+		if (format == GL_COMPRESSED_RGBA_BPTC_UNORM_ARB) {
+			BitReader reader;
+			memcpy(reader.bits, input, 16);
+			if (reader.read(7) != 1 << 6) {
+				// not mode 6, show it in magenta
+				for (int i = 0; i < 16; i++) {
+					pixels[i][0] = 255, pixels[i][1] = 0, pixels[i][2] = 255, pixels[i][3] = 255;
+				}
+				return;
+			}
+			int endpoints[2][4];
+			for (int c = 0; c < 4; c++) {
+				endpoints[0][c] = reader.read(7);
+				endpoints[1][c] = reader.read(7);
+			}
+			int sharedBits[2] = { (int)reader.read(1), (int)reader.read(1) };
+			for (int i = 0; i < 16; i++) {
+				int index = reader.read(i == 0 ? 3 : 4);
+				for (int c = 0; c < 4; c++) {
+					int value0 = endpoints[0][c] * 2 + sharedBits[0];
+					int value1 = endpoints[1][c] * 2 + sharedBits[1];
+					pixels[i][c] = (unsigned char)(((64 - BC7_WEIGHTS[index]) * value0 + BC7_WEIGHTS[index] * value1 + 32) >> 6);
+				}
+			}
+			return;
+		}
+
+		const unsigned char* color = format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT ? input + 8 : input;
+		int palette[4][4];
+		bc1Palette((uint16_t)(color[0] | color[1] << 8), (uint16_t)(color[2] | color[3] << 8), palette);
+		uint32_t colorBits;
+		memcpy(&colorBits, color + 4, 4);
+		for (int i = 0; i < 16; i++) {
+			for (int c = 0; c < 4; c++) {
+				pixels[i][c] = (unsigned char)palette[(colorBits >> (i * 2)) & 3][c];
+			}
+		}
+		if (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) {
+			int alphas[8];
+			alphaPalette(input[0], input[1], alphas);
+			uint64_t alphaBits = 0;
+			for (int i = 0; i < 6; i++) {
+				alphaBits |= (uint64_t)input[2 + i] << (i * 8);
+			}
+			for (int i = 0; i < 16; i++) {
+				pixels[i][3] = (unsigned char)alphas[(alphaBits >> (i * 3)) & 7];
+			}
+		}
+	}
+
+	// Peak signal to noise ratio in dB between the image and its compressed blocks over the image's channels,
+	// higher is better, infinite if they are equal
+	inline double psnr(const unsigned char* pixels, unsigned int width, unsigned int height, int channels, const unsigned char* blocks, GLenum format) {
+		unsigned int blocksX = (width + 3) / 4;
+		double squaredError = 0.0;
+		for (unsigned int blockY = 0; blockY < (height + 3) / 4; blockY++) {
+			for (unsigned int blockX = 0; blockX < blocksX; blockX++) {
+				unsigned char decoded[16][4];
+				decodeBlock(blocks + ((size_t)blockY * blocksX + blockX) * blockSize(format), format, decoded);
+				for (unsigned int i = 0; i < 16; i++) {
+					unsigned int x = blockX * 4 + i % 4, y = blockY * 4 + i / 4;
+					if (x >= width || y >= height) {
+						continue;
+					}
+					const unsigned char* pixel = pixels + ((size_t)y * width + x) * channels;
+					for (int c = 0; c < channels; c++) {
+						double difference = (double)pixel[c] - decoded[i][c];
+						squaredError += difference * difference;
+					}
+				}
+			}
+		}
+		double meanSquaredError = squaredError / ((double)width * height * channels);
+		return meanSquaredError == 0.0 ? INFINITY : 10.0 * log10(255.0 * 255.0 / meanSquaredError);
+	}
+}
+
+#endif
@@ -0,0 +1,478 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+
+#include <mutex>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <iostream>
+#include <condition_variable>
+
+#include "stb_image.h"
+#include "profiler.h"
+#include "state_cache.h"
+#include "thread_pool.h"
+#include "texture_cache.h"
+#include "mip_generator.h"
+#include "texture_compressor.h"
+
+using namespace std;
+
+// Loads textures without blocking the render thread.
+// load() returns a texture right away which shows a placeholder, the image is decoded on the shared thread pool.
+// update() is called once per frame and uploads the images decoded since the last frame into their textures through
+// a pixel buffer object, so the texture ids never change and nothing else has to know a texture is still loading.
+// From the PBO the driver copies the pixels without the render thread waiting for it.
+// The first time an image is loaded the job decodes it, the MipGenerator builds its mip chain and, unless
+// compression is off, the TextureCompressor compresses the levels if the context supports a suitable format, which
+// takes 4 to 8 times less memory and bandwidth when sampling. The result is baked into the TextureCache.
+// Later runs map the baked file and upload its levels, nothing is decoded. Either way the render thread only uploads.
+// loadArray() does the same for the layers of a texture array, see the TexturePacker.
+class TextureLoader {
+public:
+	static TextureLoader& instance() {
+		static TextureLoader loader;
+		return loader;
+	}
+
+	// Creates the texture and starts decoding the image, call on the render thread
+	unsigned int load(const string& path) {
+		unsigned int texture;
+		glGenTextures(1, &texture);
+		// a single mid grey texel until the image is there
+		const unsigned char placeholder[4] = { 128, 128, 128, 255 };
+		GLStateCache::instance().bindTexture(0, GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		submit(texture, path, NULL, 0, 0, 0);
+		return texture;
+	}
+
+	// Creates a texture array with one layer per image and starts decoding them, call on the render thread.
+	// Images of another size are scaled to width x height when they're baked, all images need the same channels.
+	// The array keeps its placeholder until every layer is decoded, then all of them are uploaded at once.
+	unsigned int loadArray(const vector<string>& paths, unsigned int width, unsigned int height) {
+		unsigned int texture;
+		glGenTextures(1, &texture);
+		// a mid grey texel per layer
+		vector<unsigned char> placeholder(paths.size() * 4, 128);
+		for (size_t layer = 0; layer < paths.size(); layer++) {
+			placeholder[layer * 4 + 3] = 255;
+		}
+		GLStateCache::instance().bindTexture(0, GL_TEXTURE_2D_ARRAY, texture);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, 1, 1, (GLsizei)paths.size(), 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder.data());
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		shared_ptr<PendingArray> array = make_shared<PendingArray>();
+		array->texture = texture;
+		array->paths = paths;
+		array->layers.resize(paths.size());
+		array->missing = (unsigned int)paths.size();
+		for (unsigned int layer = 0; layer < paths.size(); layer++) {
+			submit(texture, paths[layer], array, layer, width, height);
+		}
+		return texture;
+	}
+
+	// Uploads the decoded images, at most uploadBudget bytes per call (but always at least one image)
+	// so a burst of finished textures doesn't stall a single frame
+	void update() {
+		PROFILE_ZONE("UploadTextures");
+		// forget the jobs which are done, so the list doesn't grow with every texture ever loaded
+		jobs.erase(remove_if(jobs.begin(), jobs.end(), [](const future<void>& job) {
+			return job.wait_for(chrono::seconds(0)) == future_status::ready;
+		}), jobs.end());
+		vector<DecodedImage> ready;
+		{
+			lock_guard<mutex> lock(decodedMutex);
+			size_t bytes = 0;
+			size_t count = 0;
+			while (count < decoded.size() && (count == 0 || bytes + decoded[count].size() <= uploadBudget)) {
+				bytes += decoded[count].size();
+				count++;
+			}
+			ready.assign(decoded.begin(), decoded.begin() + count);
+			decoded.erase(decoded.begin(), decoded.begin() + count);
+		}
+		for (DecodedImage& image : ready) {
+			upload(image);
+		}
+	}
+
+	// Blocks until every texture requested so far is uploaded
+	void finish() {
+		PROFILE_ZONE("FinishTextures");
+		while (pending > 0) {
+			vector<DecodedImage> ready;
+			{
+				unique_lock<mutex> lock(decodedMutex);
+				decodedReady.wait(lock, [this]() { return !decoded.empty(); });
+				ready.swap(decoded);
+			}
+			for (DecodedImage& image : ready) {
+				upload(image);
+			}
+		}
+	}
+
+	// Textures which still show the placeholder
+	unsigned int pendingCount() const {
+		return pending;
+	}
+
+	// Deletes the pixel buffer object and waits until the baked textures are written, call before the context goes away
+	void destroy() {
+		for (future<void>& job : jobs) {
+			job.wait();
+		}
+		jobs.clear();
+		// Hand the images which arrived meanwhile to beforeUpload, the TextureManager only deletes a texture released
+		// while its image was decoding once the image is there
+		finish();
+		if (uploadBuffer != 0) {
+			glDeleteBuffers(1, &uploadBuffer);
+			uploadBuffer = 0;
+		}
+	}
+
+	// Bytes update() uploads per frame
+	size_t uploadBudget = 16 * 1024 * 1024;
+
+	// How images are baked, set them before loading textures
+	TextureCompression compression = TEXTURE_COMPRESSION_NORMAL;
+	MipFilter mipFilter = MIP_FILTER_KAISER;
+	bool gammaCorrectMips = true;
+
+	// Called on the render thread for every decoded image before it is uploaded into the texture, with a hash of the
+	// image's size and pixels, 0 if the image couldn't be decoded. Returning false skips the upload, e.g. because the
+	// texture was deleted meanwhile or an identical image is already uploaded.
+	function<bool(unsigned int texture, uint64_t contentHash)> beforeUpload;
+
+private:
+	// The layers of a texture array decoded so far, only touched by the render thread
+	struct PendingArray {
+		unsigned int texture = 0;
+		vector<string> paths;
+		vector<shared_ptr<BakedTexture>> layers;
+		unsigned int missing = 0;
+	};
+
+	struct DecodedImage {
+		unsigned int texture = 0;
+		string path;
+		uint64_t contentHash = 0;
+		// all levels, NULL if the image couldn't be decoded
+		shared_ptr<BakedTexture> baked;
+		// the array the image is a layer of, NULL for a 2D texture
+		shared_ptr<PendingArray> array;
+		unsigned int layer = 0;
+
+		size_t size() const {
+			return baked != NULL ? baked->pixelBytes : 0;
+		}
+	};
+
+	mutex decodedMutex;
+	condition_variable decodedReady;
+	vector<DecodedImage> decoded;
+	// only touched by the render thread
+	unsigned int pending = 0;
+	unsigned int uploadBuffer = 0;
+	// the decode jobs, which write the baked textures after handing them over
+	vector<future<void>> jobs;
+
+	// Starts the job which maps or bakes the image, a width of 0 keeps the image's size
+	void submit(unsigned int texture, const string& path, shared_ptr<PendingArray> array, unsigned int layer, unsigned int width, unsigned int height) {
+		pending++;
+		uint64_t settings = cacheSettings();
+		TextureCompression quality = compression;
+		MipFilter filter = mipFilter;
+		bool gammaCorrect = gammaCorrectMips;
+		jobs.push_back(ThreadPool::shared().submit([this, texture, path, array, layer, width, height, settings, quality, filter, gammaCorrect]() {
+			PROFILE_ZONE("DecodeTexture");
+			DecodedImage image;
+			image.texture = texture;
+			image.path = path;
+			image.array = array;
+			image.layer = layer;
+			image.baked = make_shared<BakedTexture>();
+			// A scaled image is cached separately, one which already has the size shares the file of its 2D texture.
+			// Reading the header is cheap next to decoding the image.
+			uint64_t imageSettings = settings;
+			int imageWidth, imageHeight, channels;
+			if (width != 0 && stbi_info(path.c_str(), &imageWidth, &imageHeight, &channels)
+				&& ((unsigned int)imageWidth != width || (unsigned int)imageHeight != height)) {
+				imageSettings |= ((uint64_t)width << 48) | ((uint64_t)height << 32);
+			}
+			bool cached = TextureCache::instance().map(path, imageSettings, *image.baked);
+			if (!cached && !bake(path, width, height, quality, filter, gammaCorrect, *image.baked)) {
+				image.baked.reset();
+			}
+			image.contentHash = image.baked != NULL ? image.baked->contentHash : 0;
+			shared_ptr<BakedTexture> baked = image.baked;
+			{
+				lock_guard<mutex> lock(decodedMutex);
+				decoded.push_back(image);
+			}
+			decodedReady.notify_one();
+
+			// the upload doesn't have to wait for the file to be written
+			if (!cached && baked != NULL) {
+				TextureCache::instance().store(path, imageSettings, *baked);
+			}
+		}));
+	}
+
+	// What the baked textures depend on besides the image, different settings are cached separately
+	uint64_t cacheSettings() const {
+		return (uint64_t)compression | (GLAD_GL_EXT_texture_compression_s3tc ? 1 << 4 : 0) | (GLAD_GL_ARB_texture_compression_bptc ? 1 << 5 : 0)
+			| ((uint32_t)mipFilter << 6) | (gammaCorrectMips ? 1 << 8 : 0);
+	}
+
+	// Decodes the image and builds its levels, on a worker thread
+	static bool bake(const string& path, unsigned int layerWidth, unsigned int layerHeight, TextureCompression quality, MipFilter filter, bool gammaCorrect, BakedTexture& baked) {
+		int width, height, channels;
+		// grey with alpha is baked as RGBA, the core profile has no luminance alpha format and GL_RG would show it red
+		int desiredChannels = stbi_info(path.c_str(), &width, &height, &channels) && channels == 2 ? STBI_rgb_alpha : 0;
+		unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &channels, desiredChannels);
+		if (pixels == NULL) {
+			return false;
+		}
+		if (desiredChannels != 0) {
+			channels = desiredChannels;
+		}
+		// the layers of a texture array are scaled to its size
+		vector<unsigned char> scaled;
+		if (layerWidth != 0 && ((unsigned int)width != layerWidth || (unsigned int)height != layerHeight)) {
+			scaled = MipGenerator::resize(pixels, width, height, channels, layerWidth, layerHeight, gammaCorrect);
+			width = layerWidth;
+			height = layerHeight;
+		}
+		const unsigned char* image = scaled.empty() ? pixels : scaled.data();
+		baked.contentHash = hashContent(image, width, height, channels);
+		MipGenerator::generate(image, width, height, channels, filter, gammaCorrect, baked);
+		stbi_image_free(pixels);
+
+		// the extension flags are only written while glad loads, reading them here is safe
+		GLenum compressedFormat = quality == TEXTURE_COMPRESSION_OFF ? GL_NONE : TextureCompressor::chooseFormat(channels);
+		if (compressedFormat != GL_NONE) {
+			compress(path, channels, compressedFormat, quality, baked);
+		}
+		return true;
+	}
+
+	// Replaces the levels with their compressed blocks
+	static void compress(const string& path, int channels, GLenum compressedFormat, TextureCompression quality, BakedTexture& baked) {
+		vector<unsigned char> blocks;
+		TextureLevel levels[MAX_TEXTURE_LEVELS];
+		for (unsigned int level = 0; level < baked.levelCount; level++) {
+			const TextureLevel& mip = baked.levels[level];
+			levels[level] = mip;
+			levels[level].offset = blocks.size();
+			levels[level].size = TextureCompressor::compressedSize(compressedFormat, mip.width, mip.height);
+			blocks.resize(blocks.size() + levels[level].size);
+			TextureCompressor::compress(baked.pixels + mip.offset, mip.width, mip.height, channels, compressedFormat, quality, blocks.data() + levels[level].offset);
+		}
+		// one string, so the lines of several jobs don't mix
+		stringstream report;
+		report << "Compressed " << path << " to " << TextureCompressor::formatName(compressedFormat) << ": "
+			<< baked.pixelBytes / 1024 << " KB -> " << blocks.size() / 1024 << " KB, PSNR "
+			<< TextureCompressor::psnr(baked.pixels, baked.levels[0].width, baked.levels[0].height, channels, blocks.data(), compressedFormat)
+			<< " dB" << endl;
+		cout << report.str();
+
+		baked.internalFormat = compressedFormat;
+		baked.type = GL_NONE;
+		memcpy(baked.levels, levels, sizeof(levels));
+		baked.storage.swap(blocks);
+		baked.pixels = baked.storage.data();
+		baked.pixelBytes = baked.storage.size();
+	}
+
+	// FNV-1a over 8 bytes at a time, good enough to tell images apart and cheap next to decoding them
+	static uint64_t hashContent(const unsigned char* pixels, int width, int height, int channels) {
+		const uint64_t FNV_PRIME = 1099511628211ull;
+		uint64_t hash = 14695981039346656037ull;
+		uint64_t dimensions[3] = { (uint64_t)width, (uint64_t)height, (uint64_t)channels };
+		for (uint64_t value : dimensions) {
+			hash = (hash ^ value) * FNV_PRIME;
+		}
+		size_t size = (size_t)width * height * channels;
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8) {
+			uint64_t word;
+			memcpy(&word, pixels + i, 8);
+			hash = (hash ^ word) * FNV_PRIME;
+		}
+		for (; i < size; i++) {
+			hash = (hash ^ pixels[i]) * FNV_PRIME;
+		}
+		return hash;
+	}
+
+	// Maps the pixel buffer object for bytes of pixels, NULL if it can't be mapped and the pixels have to be uploaded
+	// from client memory. While it's bound the data pointer of the upload calls is an offset into it.
+	unsigned char* mapUploadBuffer(size_t bytes) {
+		GLStateCache& glState = GLStateCache::instance();
+		if (uploadBuffer == 0) {
+			glGenBuffers(1, &uploadBuffer);
+		}
+		glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, uploadBuffer);
+		// Orphan the buffer, the driver may still be copying the previous image out of it
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+		void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		if (mapped == NULL) {
+			glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+		return (unsigned char*)mapped;
+	}
+
+	// Filtering of the finished texture, images with alpha are clamped so their borders don't bleed into each other
+	static void setSampling(GLenum target, const BakedTexture& baked) {
+		glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, baked.levelCount - 1);
+		GLint wrappingMode = baked.format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+		glTexParameteri(target, GL_TEXTURE_WRAP_S, wrappingMode);
+		glTexParameteri(target, GL_TEXTURE_WRAP_T, wrappingMode);
+		glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+
+	void upload(DecodedImage& image) {
+		PROFILE_ZONE("UploadTexture");
+		pending--;
+		if (image.array != NULL) {
+			PendingArray& array = *image.array;
+			array.layers[image.layer] = image.baked;
+			if (--array.missing == 0) {
+				uploadArray(array);
+			}
+			return;
+		}
+		bool accepted = !beforeUpload || beforeUpload(image.texture, image.contentHash);
+		if (image.baked == NULL) {
+			cout << "Texture failed to load at path: " << image.path << endl;
+			return;
+		}
+		if (!accepted) {
+			return;
+		}
+		const BakedTexture& baked = *image.baked;
+
+		GLStateCache& glState = GLStateCache::instance();
+		unsigned char* mapped = mapUploadBuffer(baked.pixelBytes);
+		if (mapped != NULL) {
+			memcpy(mapped, baked.pixels, baked.pixelBytes);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		}
+
+		glState.bindTexture(0, GL_TEXTURE_2D, image.texture);
+		// rows of RGB images with odd widths aren't a multiple of 4 bytes
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (unsigned int level = 0; level < baked.levelCount; level++) {
+			const TextureLevel& mip = baked.levels[level];
+			if (baked.type == GL_NONE) {
+				glCompressedTexImage2D(GL_TEXTURE_2D, level, baked.internalFormat, mip.width, mip.height, 0, (GLsizei)mip.size, levelData(mapped != NULL, baked.pixels, mip.offset));
+			} else {
+				glTexImage2D(GL_TEXTURE_2D, level, baked.internalFormat, mip.width, mip.height, 0, baked.format, baked.type, levelData(mapped != NULL, baked.pixels, mip.offset));
+			}
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		if (mapped != NULL) {
+			glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+		setSampling(GL_TEXTURE_2D, baked);
+	}
+
+	// The data argument of a level upload: with the pixel buffer bound it is an offset into the buffer, not a pointer
+	static const void* levelData(bool fromBuffer, const unsigned char* pixels, size_t offset) {
+		return fromBuffer ? (const void*)(uintptr_t)offset : pixels + offset;
+	}
+
+	// Allocates every level of the array for all layers and copies the layers into it
+	void uploadArray(PendingArray& array) {
+		PROFILE_ZONE("UploadTextureArray");
+		// The hash covers all layers in order, it's 0 if a layer is missing or doesn't match the first one
+		const uint64_t FNV_PRIME = 1099511628211ull;
+		uint64_t contentHash = (14695981039346656037ull ^ GL_TEXTURE_2D_ARRAY) * FNV_PRIME;
+		size_t bytes = 0;
+		for (size_t layer = 0; layer < array.layers.size(); layer++) {
+			const shared_ptr<BakedTexture>& baked = array.layers[layer];
+			const shared_ptr<BakedTexture>& first = array.layers[0];
+			if (baked == NULL) {
+				cout << "Texture failed to load at path: " << array.paths[layer] << endl;
+				contentHash = 0;
+			} else if (first != NULL && (baked->internalFormat != first->internalFormat || baked->type != first->type
+				|| baked->levelCount != first->levelCount || baked->levels[0].width != first->levels[0].width || baked->levels[0].height != first->levels[0].height)) {
+				cout << "ERROR::TEXTURE_LOADER::ARRAY_LAYER_MISMATCH " << array.paths[layer] << " doesn't have the format and size of " << array.paths[0] << endl;
+				contentHash = 0;
+			}
+			if (contentHash != 0) {
+				contentHash = (contentHash ^ baked->contentHash) * FNV_PRIME;
+				bytes += baked->pixelBytes;
+			}
+		}
+		bool accepted = !beforeUpload || beforeUpload(array.texture, contentHash);
+		if (contentHash == 0 || !accepted) {
+			return;
+		}
+		const BakedTexture& first = *array.layers[0];
+		GLsizei layerCount = (GLsizei)array.layers.size();
+
+		// Allocate the levels before the pixel buffer is bound, otherwise the NULL data would be read as an offset into it
+		GLStateCache& glState = GLStateCache::instance();
+		glState.bindTexture(0, GL_TEXTURE_2D_ARRAY, array.texture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (unsigned int level = 0; level < first.levelCount; level++) {
+			const TextureLevel& mip = first.levels[level];
+			if (first.type == GL_NONE) {
+				glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, first.internalFormat, mip.width, mip.height, layerCount, 0, (GLsizei)(mip.size * layerCount), NULL);
+			} else {
+				glTexImage3D(GL_TEXTURE_2D_ARRAY, level, first.internalFormat, mip.width, mip.height, layerCount, 0, first.format, first.type, NULL);
+			}
+		}
+
+		// the layers one after another in the pixel buffer
+		unsigned char* mapped = mapUploadBuffer(bytes);
+		if (mapped != NULL) {
+			size_t offset = 0;
+			for (const shared_ptr<BakedTexture>& baked : array.layers) {
+				memcpy(mapped + offset, baked->pixels, baked->pixelBytes);
+				offset += baked->pixelBytes;
+			}
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		}
+		size_t offset = 0;
+		for (GLsizei layer = 0; layer < layerCount; layer++) {
+			const BakedTexture& baked = *array.layers[layer];
+			size_t base = mapped != NULL ? offset : 0;
+			offset += baked.pixelBytes;
+			for (unsigned int level = 0; level < baked.levelCount; level++) {
+				const TextureLevel& mip = baked.levels[level];
+				if (baked.type == GL_NONE) {
+					glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, mip.width, mip.height, 1, baked.internalFormat, (GLsizei)mip.size, levelData(mapped != NULL, baked.pixels, base + mip.offset));
+				} else {
+					glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, mip.width, mip.height, 1, baked.format, baked.type, levelData(mapped != NULL, baked.pixels, base + mip.offset));
+				}
+			}
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		if (mapped != NULL) {
+			glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+		setSampling(GL_TEXTURE_2D_ARRAY, first);
+	}
+};
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef TEXTURE_MANAGER_H
+#define TEXTURE_MANAGER_H
+
+#include <glad/glad.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <iostream>
+#include <filesystem>
+
+#include "state_cache.h"
+#include "texture_loader.h"
+
+using namespace std;
+
+// A texture shared by everyone who acquired the same image, deleted when the last handle goes away
+struct Texture {
+	// the GL texture to bind, it changes once if the image turns out to be a duplicate of another texture
+	unsigned int id = 0;
+	// GL_TEXTURE_2D, or GL_TEXTURE_2D_ARRAY for the arrays of the TexturePacker
+	GLenum target = GL_TEXTURE_2D;
+	// canonical path of the image, the paths of all layers for an array
+	string path;
+	// the texture with identical contents this one uses instead of its own
+	shared_ptr<Texture> original;
+	// true until the image is decoded, the manager deletes textures released before that
+	bool decoding = true;
+
+	~Texture() {
+		if (original == NULL && id != 0 && !decoding) {
+			glDeleteTextures(1, &id);
+			GLStateCache::instance().forgetTexture(id);
+		}
+	}
+};
+
+typedef shared_ptr<Texture> TextureHandle;
+
+// Hands out reference counted textures and makes sure every image is only uploaded once:
+//  - acquiring a path which is already loaded returns the same texture, paths are compared in canonical form
+//  - an image with the same size and pixels as a loaded one (e.g. a copy of a file) uses that texture,
+//    this is known once the image is decoded, until then it shows its own placeholder
+// The manager only keeps weak references. When the last handle of a texture is released its GL texture is
+// deleted, so release all handles before the context goes away.
+class TextureManager {
+public:
+	static TextureManager& instance() {
+		static TextureManager manager;
+		return manager;
+	}
+
+	// Returns the texture of the image, starting to load it if nobody holds it yet
+	TextureHandle acquire(const string& path) {
+		requests++;
+		string key = canonicalPath(path);
+		if (TextureHandle texture = find(key)) {
+			return texture;
+		}
+
+		TextureHandle texture = make_shared<Texture>();
+		texture->path = key;
+		texture->id = TextureLoader::instance().load(path);
+		track(texture);
+		return texture;
+	}
+
+	// Returns the texture array with the images as its layers, see TextureLoader::loadArray().
+	// The same images in the same order and size share an array.
+	TextureHandle acquireArray(const vector<string>& paths, unsigned int width, unsigned int height) {
+		requests++;
+		string key = to_string(width) + "x" + to_string(height);
+		for (const string& path : paths) {
+			key += "|" + canonicalPath(path);
+		}
+		if (TextureHandle texture = find(key)) {
+			return texture;
+		}
+
+		TextureHandle texture = make_shared<Texture>();
+		texture->target = GL_TEXTURE_2D_ARRAY;
+		texture->path = key;
+		texture->id = TextureLoader::instance().loadArray(paths, width, height);
+		track(texture);
+		return texture;
+	}
+
+	// Uploads the images decoded since the last call, call once per frame
+	void update() {
+		TextureLoader& loader = TextureLoader::instance();
+		if (loader.pendingCount() > 0) {
+			loader.update();
+		}
+	}
+
+	// Blocks until every acquired texture is uploaded
+	void finish() {
+		TextureLoader::instance().finish();
+	}
+
+	// Textures which are alive, each GL texture counted once
+	unsigned int textureCount() {
+		unsigned int count = 0;
+		for (map<uint64_t, weak_ptr<Texture>>::iterator i = byContent.begin(); i != byContent.end();) {
+			if (i->second.expired()) {
+				i = byContent.erase(i);
+			} else {
+				count++;
+				i++;
+			}
+		}
+		return count;
+	}
+
+	// acquire() calls
+	unsigned int requests = 0;
+	// acquire() calls which returned a texture that was already loaded
+	unsigned int pathHits = 0;
+	// images which weren't uploaded because an identical one was
+	unsigned int contentDuplicates = 0;
+
+private:
+	// by canonical path
+	map<string, weak_ptr<Texture>> byPath;
+	// by content hash, only textures which were uploaded
+	map<uint64_t, weak_ptr<Texture>> byContent;
+	// by GL texture, textures whose image is still being decoded
+	map<unsigned int, weak_ptr<Texture>> decoding;
+
+	TextureHandle find(const string& key) {
+		map<string, weak_ptr<Texture>>::iterator known = byPath.find(key);
+		if (known != byPath.end()) {
+			if (TextureHandle texture = known->second.lock()) {
+				pathHits++;
+				return texture;
+			}
+		}
+		return NULL;
+	}
+
+	void track(const TextureHandle& texture) {
+		byPath[texture->path] = texture;
+		decoding[texture->id] = texture;
+	}
+
+	TextureManager() {
+		TextureLoader::instance().beforeUpload = [this](unsigned int id, uint64_t contentHash) {
+			return decoded(id, contentHash);
+		};
+	}
+
+	bool decoded(unsigned int id, uint64_t contentHash) {
+		map<unsigned int, weak_ptr<Texture>>::iterator entry = decoding.find(id);
+		if (entry == decoding.end()) {
+			// loaded directly through the TextureLoader
+			return true;
+		}
+		TextureHandle texture = entry->second.lock();
+		decoding.erase(entry);
+		if (texture == NULL) {
+			// Released while decoding. The texture is deleted only now, otherwise a texture created meanwhile
+			// could have gotten the same id and this image would be uploaded into it.
+			glDeleteTextures(1, &id);
+			GLStateCache::instance().forgetTexture(id);
+			return false;
+		}
+		texture->decoding = false;
+		if (contentHash == 0) {
+			// the image couldn't be decoded, keep the placeholder
+			return false;
+		}
+
+		TextureHandle original = byContent[contentHash].lock();
+		if (original != NULL) {
+			contentDuplicates++;
+			glDeleteTextures(1, &texture->id);
+			GLStateCache::instance().forgetTexture(texture->id);
+			texture->id = original->id;
+			texture->original = original;
+			return false;
+		}
+		byContent[contentHash] = texture;
+		return true;
+	}
+
+	static string canonicalPath(const string& path) {
+		error_code error;
+		filesystem::path canonical = filesystem::weakly_canonical(path, error);
+		return error ? filesystem::path(path).lexically_normal().generic_string() : canonical.generic_string();
+	}
+};
+
+#endif
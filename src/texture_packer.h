@@ -0,0 +1,94 @@
+#ifndef TEXTURE_PACKER_H
+#define TEXTURE_PACKER_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "stb_image.h"
+#include "texture_manager.h"
+
+using namespace std;
+
+// Where an image ended up: the texture array and the layer in it
+struct PackedTexture {
+	TextureHandle array;
+	unsigned int layer = 0;
+};
+
+// Packs images into the layers of texture arrays, so objects with different images can be drawn with one call,
+// each instance picking its layer. All layers of an array have the same size and format, so the images are grouped:
+//  - by channels, which decide the format an image is baked to
+//  - by size, an image joins a group if the largest and smallest image of the group stay within twice each other's
+//    width and height. The group takes the largest size and the smaller images are scaled up when they're baked,
+//    e.g. a 256x256 image in a group of 512x512 ones takes 4 times the memory it would on its own.
+// A layer is sampled with the coordinates of the image, scaling it to another size doesn't change what an object shows.
+// Only the headers are read here, the images are loaded by the TextureLoader like any other texture.
+namespace TexturePacker {
+	// Images whose sizes are further apart than this don't share an array
+	const unsigned int MAX_SCALE = 2;
+
+	struct Group {
+		int channels = 0;
+		unsigned int minWidth = 0, minHeight = 0;
+		unsigned int maxWidth = 0, maxHeight = 0;
+		vector<string> paths;
+
+		bool fits(int imageChannels, unsigned int width, unsigned int height) const {
+			return channels == imageChannels
+				&& max(maxWidth, width) <= min(minWidth, width) * MAX_SCALE
+				&& max(maxHeight, height) <= min(minHeight, height) * MAX_SCALE;
+		}
+	};
+
+	// Returns the array and layer of every image, in the order of paths. Call on the render thread.
+	inline vector<PackedTexture> pack(const vector<string>& paths) {
+		vector<Group> groups;
+		// the group and the layer in it of every image
+		vector<pair<size_t, unsigned int>> placement;
+		for (const string& path : paths) {
+			int width = 0, height = 0, channels = 0;
+			if (!stbi_info(path.c_str(), &width, &height, &channels)) {
+				// an array of its own, which keeps the placeholder once the loader finds out the image is broken
+				channels = -(int)groups.size() - 1;
+				width = height = 1;
+			} else if (channels == 2) {
+				// the loader bakes grey with alpha as RGBA
+				channels = 4;
+			}
+			size_t group = 0;
+			while (group < groups.size() && !groups[group].fits(channels, width, height)) {
+				group++;
+			}
+			if (group == groups.size()) {
+				Group created;
+				created.channels = channels;
+				created.minWidth = created.maxWidth = width;
+				created.minHeight = created.maxHeight = height;
+				groups.push_back(created);
+			}
+			Group& target = groups[group];
+			target.minWidth = min(target.minWidth, (unsigned int)width);
+			target.minHeight = min(target.minHeight, (unsigned int)height);
+			target.maxWidth = max(target.maxWidth, (unsigned int)width);
+			target.maxHeight = max(target.maxHeight, (unsigned int)height);
+			placement.push_back(make_pair(group, (unsigned int)target.paths.size()));
+			target.paths.push_back(path);
+		}
+
+		vector<TextureHandle> arrays;
+		for (const Group& group : groups) {
+			arrays.push_back(TextureManager::instance().acquireArray(group.paths, group.maxWidth, group.maxHeight));
+		}
+		vector<PackedTexture> packed(paths.size());
+		for (size_t i = 0; i < paths.size(); i++) {
+			packed[i].array = arrays[placement[i].first];
+			packed[i].layer = placement[i].second;
+		}
+		return packed;
+	}
+}
+
+#endif
@@ -0,0 +1,165 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <exception>
+#include <future>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+using namespace std;
+
+// A fixed set of worker threads which run submitted jobs in the order they were submitted.
+// The threads are started once and sleep while there is nothing to do, so handing them work is cheap compared
+// to creating a thread for every job. Jobs must not touch OpenGL, the context belongs to the render thread.
+class ThreadPool {
+public:
+	// By default one thread per core
+	explicit ThreadPool(unsigned int threadCount = 0) {
+		if (threadCount == 0) {
+			threadCount = thread::hardware_concurrency();
+		}
+		if (threadCount == 0) {
+			threadCount = 1;
+		}
+		for (unsigned int i = 0; i < threadCount; i++) {
+			workers.push_back(thread(&ThreadPool::run, this));
+		}
+	}
+
+	~ThreadPool() {
+		{
+			lock_guard<mutex> lock(jobsMutex);
+			stopping = true;
+		}
+		jobsAvailable.notify_all();
+		for (thread& worker : workers) {
+			worker.join();
+		}
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// The pool shared by the loaders, created on first use
+	static ThreadPool& shared() {
+		static ThreadPool pool;
+		return pool;
+	}
+
+	unsigned int size() const {
+		return (unsigned int)workers.size();
+	}
+
+	// Runs the job on a worker thread, the future becomes ready when it finished
+	future<void> submit(function<void()> job) {
+		shared_ptr<packaged_task<void()>> task = make_shared<packaged_task<void()>>(move(job));
+		future<void> result = task->get_future();
+		{
+			lock_guard<mutex> lock(jobsMutex);
+			jobs.push_back([task]() { (*task)(); });
+		}
+		jobsAvailable.notify_one();
+		return result;
+	}
+
+	// Calls body(begin, end) for ranges covering [0, count) on the workers and waits until all of them are done.
+	// A range holds at least minRange items, so small counts don't pay for the hand off.
+	// The ranges are claimed from a shared counter by the workers and by the calling thread, which never waits for a
+	// range nobody started. So a job may call it too, even with every worker busy, and the caller only ever runs
+	// ranges of this loop, never unrelated jobs.
+	void parallelFor(size_t count, const function<void(size_t, size_t)>& body, size_t minRange = 1) {
+		if (count == 0) {
+			return;
+		}
+		size_t ranges = size() * 4;
+		if (minRange > 0 && count / minRange < ranges) {
+			ranges = count / minRange;
+		}
+		if (ranges <= 1) {
+			body(0, count);
+			return;
+		}
+		// shared with the helpers, one which starts after the loop is done finds no range left and returns
+		shared_ptr<ParallelLoop> loop = make_shared<ParallelLoop>();
+		loop->body = &body;
+		loop->count = count;
+		loop->ranges = ranges;
+		size_t helpers = min(ranges - 1, (size_t)size());
+		{
+			lock_guard<mutex> lock(jobsMutex);
+			for (size_t i = 0; i < helpers; i++) {
+				jobs.push_back([loop]() { loop->work(); });
+			}
+		}
+		jobsAvailable.notify_all();
+		loop->work();
+		{
+			unique_lock<mutex> lock(loop->finishedMutex);
+			loop->allFinished.wait(lock, [&loop]() { return loop->finished == loop->ranges; });
+		}
+		if (loop->error) {
+			rethrow_exception(loop->error);
+		}
+	}
+
+private:
+	vector<thread> workers;
+	mutex jobsMutex;
+	condition_variable jobsAvailable;
+	deque<function<void()>> jobs;
+	bool stopping = false;
+
+	struct ParallelLoop {
+		const function<void(size_t, size_t)>* body = NULL;
+		size_t count = 0;
+		size_t ranges = 0;
+		atomic<size_t> next{ 0 };
+		mutex finishedMutex;
+		condition_variable allFinished;
+		size_t finished = 0;
+		exception_ptr error;
+
+		// Runs ranges until none is left
+		void work() {
+			for (size_t range = next++; range < ranges; range = next++) {
+				exception_ptr failure;
+				try {
+					(*body)(count * range / ranges, count * (range + 1) / ranges);
+				} catch (...) {
+					failure = current_exception();
+				}
+				lock_guard<mutex> lock(finishedMutex);
+				if (failure && !error) {
+					error = failure;
+				}
+				if (++finished == ranges) {
+					allFinished.notify_all();
+				}
+			}
+		}
+	};
+
+	void run() {
+		while (true) {
+			function<void()> job;
+			{
+				unique_lock<mutex> lock(jobsMutex);
+				jobsAvailable.wait(lock, [this]() { return stopping || !jobs.empty(); });
+				if (jobs.empty()) {
+					return;
+				}
+				job = move(jobs.front());
+				jobs.pop_front();
+			}
+			job();
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef TRANSFORM_BATCH_H
+#define TRANSFORM_BATCH_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <xmmintrin.h>
+#define TRANSFORM_BATCH_SSE
+#endif
+
+#include "profiler.h"
+
+using namespace std;
+
+// Model and normal matrices of many objects, computed together once per frame.
+// Every object is translate(position) * rotate(angle, axis) * scale(scale) * translate(-pivot), the same matrix
+// glm::translate, glm::rotate and glm::scale would build. The pivot is the point of the model which ends up at
+// position and which it rotates around, usually the origin. The inputs are stored as structure of arrays, so four objects fit into
+// one SSE register and each matrix element of four objects is computed with a handful of instructions.
+// Because the rotation is orthonormal the normal matrix (the inverse transpose of the upper 3x3) is just the
+// rotation with each column divided by its scale, no matrix has to be inverted, neither here nor in the shader.
+class TransformBatch {
+public:
+	// inputs, one entry per object
+	vector<float> positionX, positionY, positionZ;
+	// normalized rotation axis
+	vector<float> axisX, axisY, axisZ;
+	// rotation angle in radians
+	vector<float> angle;
+	vector<float> scaleX, scaleY, scaleZ;
+	vector<float> pivotX, pivotY, pivotZ;
+
+	// outputs of update(), tightly packed so they can be uploaded to a buffer as they are
+	vector<glm::mat4> models;
+	vector<glm::mat3> normalMatrices;
+
+	// Adds an object and returns its index
+	unsigned int add(const glm::vec3& position, const glm::vec3& axis = glm::vec3(0.0f, 0.0f, 1.0f), float angle = 0.0f, const glm::vec3& scale = glm::vec3(1.0f), const glm::vec3& pivot = glm::vec3(0.0f)) {
+		glm::vec3 normalizedAxis = glm::normalize(axis);
+		positionX.push_back(position.x);
+		positionY.push_back(position.y);
+		positionZ.push_back(position.z);
+		axisX.push_back(normalizedAxis.x);
+		axisY.push_back(normalizedAxis.y);
+		axisZ.push_back(normalizedAxis.z);
+		this->angle.push_back(angle);
+		scaleX.push_back(scale.x);
+		scaleY.push_back(scale.y);
+		scaleZ.push_back(scale.z);
+		pivotX.push_back(pivot.x);
+		pivotY.push_back(pivot.y);
+		pivotZ.push_back(pivot.z);
+		return (unsigned int)size() - 1;
+	}
+
+	size_t size() const {
+		return angle.size();
+	}
+
+	// Computes models and normalMatrices of all objects
+	void update() {
+		PROFILE_ZONE("UpdateTransforms");
+		size_t count = size();
+		models.resize(count);
+		normalMatrices.resize(count);
+		sines.resize(count);
+		cosines.resize(count);
+
+		// there is no SSE sine, the compiler vectorizes this loop as far as the math library allows
+		for (size_t i = 0; i < count; i++) {
+			sines[i] = sin(angle[i]);
+			cosines[i] = cos(angle[i]);
+		}
+
+		size_t i = 0;
+#ifdef TRANSFORM_BATCH_SSE
+		for (; i + 4 <= count; i += 4) {
+			updateFour(i);
+		}
+#endif
+		for (; i < count; i++) {
+			updateOne(i);
+		}
+	}
+
+private:
+	vector<float> sines;
+	vector<float> cosines;
+
+	// The axis angle rotation (see glm::rotate) has the columns
+	//	col0 = (c + t x x,   t x y + s z, t x z - s y)
+	//	col1 = (t x y - s z, c + t y y,   t y z + s x)
+	//	col2 = (t x z + s y, t y z - s x, c + t z z)
+	// with t = 1 - c
+	void updateOne(size_t i) {
+		float c = cosines[i];
+		float s = sines[i];
+		float x = axisX[i], y = axisY[i], z = axisZ[i];
+		float tx = (1.0f - c) * x, ty = (1.0f - c) * y, tz = (1.0f - c) * z;
+
+		glm::mat3 rotation;
+		rotation[0] = glm::vec3(c + tx * x, tx * y + s * z, tx * z - s * y);
+		rotation[1] = glm::vec3(ty * x - s * z, c + ty * y, ty * z + s * x);
+		rotation[2] = glm::vec3(tz * x + s * y, tz * y - s * x, c + tz * z);
+
+		glm::vec3 scale(scaleX[i], scaleY[i], scaleZ[i]);
+		glm::mat4& model = models[i];
+		glm::mat3& normalMatrix = normalMatrices[i];
+		for (int column = 0; column < 3; column++) {
+			model[column] = glm::vec4(rotation[column] * scale[column], 0.0f);
+			normalMatrix[column] = rotation[column] * (1.0f / scale[column]);
+		}
+		glm::vec3 pivot(pivotX[i], pivotY[i], pivotZ[i]);
+		model[3] = glm::vec4(glm::vec3(positionX[i], positionY[i], positionZ[i]) - glm::mat3(model) * pivot, 1.0f);
+	}
+
+#ifdef TRANSFORM_BATCH_SSE
+	// Same as updateOne for the objects i to i + 3, every register holds one value of four objects
+	void updateFour(size_t i) {
+		__m128 one = _mm_set1_ps(1.0f);
+		__m128 zero = _mm_setzero_ps();
+		__m128 c = _mm_loadu_ps(&cosines[i]);
+		__m128 s = _mm_loadu_ps(&sines[i]);
+		__m128 x = _mm_loadu_ps(&axisX[i]);
+		__m128 y = _mm_loadu_ps(&axisY[i]);
+		__m128 z = _mm_loadu_ps(&axisZ[i]);
+		__m128 t = _mm_sub_ps(one, c);
+		__m128 tx = _mm_mul_ps(t, x), ty = _mm_mul_ps(t, y), tz = _mm_mul_ps(t, z);
+		__m128 sx = _mm_mul_ps(s, x), sy = _mm_mul_ps(s, y), sz = _mm_mul_ps(s, z);
+
+		// rotation[column][row]
+		__m128 rotation[3][3] = {
+			{ _mm_add_ps(c, _mm_mul_ps(tx, x)), _mm_add_ps(_mm_mul_ps(tx, y), sz), _mm_sub_ps(_mm_mul_ps(tx, z), sy) },
+			{ _mm_sub_ps(_mm_mul_ps(ty, x), sz), _mm_add_ps(c, _mm_mul_ps(ty, y)), _mm_add_ps(_mm_mul_ps(ty, z), sx) },
+			{ _mm_add_ps(_mm_mul_ps(tz, x), sy), _mm_sub_ps(_mm_mul_ps(tz, y), sx), _mm_add_ps(c, _mm_mul_ps(tz, z)) }
+		};
+		__m128 scale[3] = { _mm_loadu_ps(&scaleX[i]), _mm_loadu_ps(&scaleY[i]), _mm_loadu_ps(&scaleZ[i]) };
+		__m128 pivot[3] = { _mm_loadu_ps(&pivotX[i]), _mm_loadu_ps(&pivotY[i]), _mm_loadu_ps(&pivotZ[i]) };
+		// the translation, position minus the scaled and rotated pivot
+		__m128 translation[3] = { _mm_loadu_ps(&positionX[i]), _mm_loadu_ps(&positionY[i]), _mm_loadu_ps(&positionZ[i]) };
+
+		for (int column = 0; column < 3; column++) {
+			__m128 row0 = _mm_mul_ps(rotation[column][0], scale[column]);
+			__m128 row1 = _mm_mul_ps(rotation[column][1], scale[column]);
+			__m128 row2 = _mm_mul_ps(rotation[column][2], scale[column]);
+			__m128 row3 = zero;
+			translation[0] = _mm_sub_ps(translation[0], _mm_mul_ps(row0, pivot[column]));
+			translation[1] = _mm_sub_ps(translation[1], _mm_mul_ps(row1, pivot[column]));
+			translation[2] = _mm_sub_ps(translation[2], _mm_mul_ps(row2, pivot[column]));
+			// turn "one row of four objects" into "one column of each object"
+			_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+			_mm_storeu_ps(&models[i + 0][column][0], row0);
+			_mm_storeu_ps(&models[i + 1][column][0], row1);
+			_mm_storeu_ps(&models[i + 2][column][0], row2);
+			_mm_storeu_ps(&models[i + 3][column][0], row3);
+
+			// a mat3 column is only three floats, so write them one object at a time
+			__m128 inverseScale = _mm_div_ps(one, scale[column]);
+			float normal[3][4];
+			for (int row = 0; row < 3; row++) {
+				_mm_storeu_ps(normal[row], _mm_mul_ps(rotation[column][row], inverseScale));
+			}
+			for (int object = 0; object < 4; object++) {
+				normalMatrices[i + object][column] = glm::vec3(normal[0][object], normal[1][object], normal[2][object]);
+			}
+		}
+
+		__m128 row0 = translation[0];
+		__m128 row1 = translation[1];
+		__m128 row2 = translation[2];
+		__m128 row3 = one;
+		_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+		_mm_storeu_ps(&models[i + 0][3][0], row0);
+		_mm_storeu_ps(&models[i + 1][3][0], row1);
+		_mm_storeu_ps(&models[i + 2][3][0], row2);
+		_mm_storeu_ps(&models[i + 3][3][0], row3);
+	}
+#endif
+};
+
+#endif
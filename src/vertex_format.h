@@ -0,0 +1,196 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/packing.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+// How an attribute is stored in the vertex buffer
+enum VertexAttributeFormat {
+	// 32 bit float per component
+	ATTRIBUTE_FLOAT,
+	// 16 bit float per component, exact for small integers and halves (e.g. the corners of a unit cube)
+	ATTRIBUTE_HALF,
+	// 16 bit unsigned normalized per component, for values in [0, 1] like texture coordinates
+	ATTRIBUTE_UNORM16,
+	// three components in [-1, 1] with 10 bits each in one 32 bit word (GL_INT_2_10_10_10_REV), for normals
+	ATTRIBUTE_SNORM_10_10_10_2,
+	// a unit vector folded onto an octahedron and stored as two 16 bit snorms, the shader has to decode it
+	// with decodeOctahedral() from shaders/include/octahedral.glsl
+	ATTRIBUTE_OCTAHEDRAL
+};
+
+// Bytes an attribute takes in a packed vertex, rounded up to 4 so the next attribute is aligned
+constexpr unsigned int packedAttributeSize(VertexAttributeFormat format, unsigned int components) {
+	switch (format) {
+		case ATTRIBUTE_FLOAT:
+			return components * 4;
+		case ATTRIBUTE_HALF:
+		case ATTRIBUTE_UNORM16:
+			return (components * 2 + 3) & ~3u;
+		case ATTRIBUTE_SNORM_10_10_10_2:
+		case ATTRIBUTE_OCTAHEDRAL:
+			return 4;
+	}
+	return 0;
+}
+
+// The size, type and normalized arguments of glVertexAttribPointer for an attribute
+struct VertexAttributePointer {
+	GLint size;
+	GLenum type;
+	GLboolean normalized;
+};
+
+constexpr VertexAttributePointer vertexAttributePointer(VertexAttributeFormat format, unsigned int components) {
+	switch (format) {
+		case ATTRIBUTE_FLOAT:
+			break;
+		case ATTRIBUTE_HALF:
+			return { (GLint)components, GL_HALF_FLOAT, GL_FALSE };
+		case ATTRIBUTE_UNORM16:
+			return { (GLint)components, GL_UNSIGNED_SHORT, GL_TRUE };
+		case ATTRIBUTE_SNORM_10_10_10_2:
+			// packed types always have 4 components, the shader just ignores the 2 bit w
+			return { 4, GL_INT_2_10_10_10_REV, GL_TRUE };
+		case ATTRIBUTE_OCTAHEDRAL:
+			return { 2, GL_SHORT, GL_TRUE };
+	}
+	return { (GLint)components, GL_FLOAT, GL_FALSE };
+}
+
+struct VertexAttribute {
+	// the layout (location = ...) in the vertex shader
+	unsigned int location;
+	// float components of the attribute in the source vertices
+	unsigned int components;
+	VertexAttributeFormat format;
+	// byte offset in the packed vertex
+	unsigned int offset;
+};
+
+// Describes the vertices of a buffer, packs float vertices into it and sets up the attribute pointers,
+// so changing how a mesh is stored is a matter of changing its format:
+//
+//	VertexFormat format;
+//	format.add(0, 3, ATTRIBUTE_HALF).add(1, 2, ATTRIBUTE_UNORM16).add(2, 3, ATTRIBUTE_SNORM_10_10_10_2);
+//	vector<unsigned char> data = format.pack(vertices, vertexCount);
+//	glBufferData(GL_ARRAY_BUFFER, data.size(), data.data(), GL_STATIC_DRAW);
+//	format.setup();
+//
+// The source vertices hold the attributes as floats in the order they were added. Every packed attribute starts at a
+// multiple of 4 bytes, which is what most hardware wants.
+class VertexFormat {
+public:
+	VertexFormat& add(unsigned int location, unsigned int components, VertexAttributeFormat format = ATTRIBUTE_FLOAT) {
+		VertexAttribute attribute;
+		attribute.location = location;
+		attribute.components = components;
+		attribute.format = format;
+		attribute.offset = vertexSize;
+		attributes.push_back(attribute);
+		vertexSize += packedAttributeSize(format, components);
+		sourceComponents += components;
+		return *this;
+	}
+
+	// Bytes of one packed vertex
+	unsigned int stride() const {
+		return vertexSize;
+	}
+
+	// Floats of one source vertex
+	unsigned int sourceStride() const {
+		return sourceComponents;
+	}
+
+	const vector<VertexAttribute>& attributeList() const {
+		return attributes;
+	}
+
+	// Converts the float vertices into the packed format
+	vector<unsigned char> pack(const float* vertices, size_t vertexCount) const {
+		vector<unsigned char> data(vertexCount * vertexSize, 0);
+		for (size_t i = 0; i < vertexCount; i++) {
+			packVertex(vertices + i * sourceComponents, data.data() + i * vertexSize);
+		}
+		return data;
+	}
+
+	// Converts one vertex of sourceStride() floats into stride() bytes
+	void packVertex(const float* source, unsigned char* vertex) const {
+		for (const VertexAttribute& attribute : attributes) {
+			packAttribute(attribute, source, vertex + attribute.offset);
+			source += attribute.components;
+		}
+	}
+
+	// Points the attributes of the bound vertex array object at the bound GL_ARRAY_BUFFER
+	void setup(size_t bufferOffset = 0) const {
+		for (const VertexAttribute& attribute : attributes) {
+			VertexAttributePointer pointer = vertexAttributePointer(attribute.format, attribute.components);
+			glVertexAttribPointer(attribute.location, pointer.size, pointer.type, pointer.normalized, vertexSize, (void*)(bufferOffset + attribute.offset));
+			glEnableVertexAttribArray(attribute.location);
+		}
+	}
+
+	// Folds a unit vector onto the octahedron |x| + |y| + |z| = 1 and unfolds that onto the square [-1, 1]^2
+	static glm::vec2 encodeOctahedral(glm::vec3 n) {
+		n /= fabs(n.x) + fabs(n.y) + fabs(n.z);
+		glm::vec2 encoded(n.x, n.y);
+		if (n.z < 0.0f) {
+			encoded = glm::vec2((1.0f - fabs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f), (1.0f - fabs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+		}
+		return encoded;
+	}
+
+private:
+	vector<VertexAttribute> attributes;
+	unsigned int vertexSize = 0;
+	unsigned int sourceComponents = 0;
+
+	static void packAttribute(const VertexAttribute& attribute, const float* source, unsigned char* destination) {
+		switch (attribute.format) {
+			case ATTRIBUTE_FLOAT:
+				memcpy(destination, source, attribute.components * sizeof(float));
+				break;
+			case ATTRIBUTE_HALF:
+				for (unsigned int c = 0; c < attribute.components; c++) {
+					uint16_t half = glm::packHalf1x16(source[c]);
+					memcpy(destination + c * 2, &half, 2);
+				}
+				break;
+			case ATTRIBUTE_UNORM16:
+				for (unsigned int c = 0; c < attribute.components; c++) {
+					uint16_t value = (uint16_t)glm::round(glm::clamp(source[c], 0.0f, 1.0f) * 65535.0f);
+					memcpy(destination + c * 2, &value, 2);
+				}
+				break;
+			case ATTRIBUTE_SNORM_10_10_10_2: {
+				glm::vec4 value(0.0f);
+				for (unsigned int c = 0; c < attribute.components && c < 3; c++) {
+					value[c] = source[c];
+				}
+				uint32_t packed = glm::packSnorm3x10_1x2(value);
+				memcpy(destination, &packed, 4);
+				break;
+			}
+			case ATTRIBUTE_OCTAHEDRAL: {
+				glm::vec2 encoded = encodeOctahedral(glm::vec3(source[0], source[1], source[2]));
+				uint32_t packed = glm::packSnorm2x16(encoded);
+				memcpy(destination, &packed, 4);
+				break;
+			}
+		}
+	}
+};
+
+#endif
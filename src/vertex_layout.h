@@ -0,0 +1,114 @@
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <utility>
+
+#include "vertex_format.h"
+
+using namespace std;
+
+// One attribute of a VertexLayout: the shader location, the float components it has in the source vertices and
+// how it is stored (see VertexAttributeFormat)
+template<unsigned int Location, unsigned int Components, VertexAttributeFormat Format>
+struct VertexLayoutAttribute {
+	static constexpr unsigned int location = Location;
+	static constexpr unsigned int components = Components;
+	static constexpr VertexAttributeFormat format = Format;
+	static constexpr unsigned int size = packedAttributeSize(Format, Components);
+	static constexpr VertexAttributePointer pointer = vertexAttributePointer(Format, Components);
+};
+
+// The attributes our shaders read, layout (location=0) is the position, 1 the texture coordinates and 2 the normal
+using Position3f = VertexLayoutAttribute<0, 3, ATTRIBUTE_FLOAT>;
+using Position3h = VertexLayoutAttribute<0, 3, ATTRIBUTE_HALF>;
+using TexCoord2f = VertexLayoutAttribute<1, 2, ATTRIBUTE_FLOAT>;
+using TexCoord2unorm16 = VertexLayoutAttribute<1, 2, ATTRIBUTE_UNORM16>;
+using Normal3f = VertexLayoutAttribute<2, 3, ATTRIBUTE_FLOAT>;
+using Normal3snorm10 = VertexLayoutAttribute<2, 3, ATTRIBUTE_SNORM_10_10_10_2>;
+using NormalOctahedral = VertexLayoutAttribute<2, 3, ATTRIBUTE_OCTAHEDRAL>;
+
+// A vertex format known at compile time. Stride and offsets are constants, so setup() compiles down to the
+// glVertexAttribPointer calls one would write by hand, and a vertex struct can be checked against the layout:
+//
+//	struct Vertex { glm::vec3 position; glm::vec2 texCoords; };
+//	using Layout = VertexLayout<Position3f, TexCoord2f>;
+//	static_assert(Layout::matches<Vertex>(offsetof(Vertex, position), offsetof(Vertex, texCoords)), "Vertex doesn't match its layout");
+//
+// Use VertexFormat instead when the format is only known at run time, e.g. read from a file.
+// Both place the attributes the same way, format() returns the matching VertexFormat.
+template<typename... Attributes>
+class VertexLayout {
+public:
+	static_assert(sizeof...(Attributes) > 0, "A vertex layout needs at least one attribute");
+
+	static constexpr unsigned int count = sizeof...(Attributes);
+	// Bytes of one packed vertex
+	static constexpr unsigned int stride = (Attributes::size + ...);
+	// Floats of one source vertex
+	static constexpr unsigned int sourceStride = (Attributes::components + ...);
+
+	// Byte offset of the attribute with the given index in the packed vertex
+	static constexpr unsigned int offset(unsigned int index) {
+		const unsigned int sizes[] = { Attributes::size... };
+		unsigned int result = 0;
+		for (unsigned int i = 0; i < index; i++) {
+			result += sizes[i];
+		}
+		return result;
+	}
+
+	// True if Vertex has the size of a packed vertex and its members, given with offsetof in the order of the
+	// attributes, are where the layout puts them
+	template<typename Vertex, typename... Offsets>
+	static constexpr bool matches(Offsets... offsets) {
+		static_assert(sizeof...(Offsets) == sizeof...(Attributes), "Pass the offset of every attribute");
+		if (sizeof(Vertex) != stride) {
+			return false;
+		}
+		const size_t memberOffsets[] = { (size_t)offsets... };
+		for (unsigned int i = 0; i < count; i++) {
+			if (memberOffsets[i] != offset(i)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Points the attributes of the bound vertex array object at the bound GL_ARRAY_BUFFER
+	static void setup(size_t bufferOffset = 0) {
+		setupAttributes(bufferOffset, make_index_sequence<sizeof...(Attributes)>());
+	}
+
+	static VertexFormat format() {
+		VertexFormat result;
+		(result.add(Attributes::location, Attributes::components, Attributes::format), ...);
+		return result;
+	}
+
+	// Converts float vertices with sourceStride floats each into packed vertices
+	template<typename Vertex>
+	static vector<Vertex> pack(const float* vertices, size_t vertexCount) {
+		static_assert(sizeof(Vertex) == stride, "The vertex struct doesn't have the size of the layout");
+		vector<unsigned char> data = format().pack(vertices, vertexCount);
+		vector<Vertex> result(vertexCount);
+		memcpy(result.data(), data.data(), data.size());
+		return result;
+	}
+
+private:
+	template<size_t... Indices>
+	static void setupAttributes(size_t bufferOffset, index_sequence<Indices...>) {
+		(setupAttribute<Attributes, offset(Indices)>(bufferOffset), ...);
+	}
+
+	template<typename Attribute, unsigned int Offset>
+	static void setupAttribute(size_t bufferOffset) {
+		glVertexAttribPointer(Attribute::location, Attribute::pointer.size, Attribute::pointer.type, Attribute::pointer.normalized, stride, (void*)(bufferOffset + Offset));
+		glEnableVertexAttribArray(Attribute::location);
+	}
+};
+
+#endif